@@ -0,0 +1,376 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/** g4me-bench: runs the benchmark macros with g4me, measures
+    events/s, peak RSS, output bytes/event and startup time
+    and compares them with a baseline JSON file **/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+typedef std::map<std::string, double> Metrics_t;
+typedef std::map<std::string, Metrics_t> Results_t;
+
+struct Metric_t {
+  std::string name;
+  bool higherIsBetter;
+  double tolerance;
+};
+
+std::vector<Metric_t> gMetrics = {
+  {"events_per_s"   , true  , 0.10},
+  {"peak_rss_mb"    , false , 0.10},
+  {"bytes_per_event", false , 0.02},
+  {"startup_s"      , false , 0.25}
+};
+
+/** the benchmarks are the macros whose first line is this tag,
+    the others are common setups executed by them **/
+const std::string gBenchmarkTag = "### benchmark:";
+
+/*****************************************************************/
+
+void
+usage()
+{
+  std::cout << "usage: g4me-bench [options] [benchmark ...]" << std::endl
+	    << "  --g4me <path>          g4me executable (default: g4me)" << std::endl
+	    << "  --share <dir>          share directory with g4macro, py8config and data" << std::endl
+	    << "  --macros <dir>         directory with the benchmark macros, G4ME_BENCH in the macros" << std::endl
+	    << "  --baseline <file>      baseline JSON to compare with" << std::endl
+	    << "  --output <file>        write the measured results to JSON" << std::endl
+	    << "  --update               overwrite the baseline with the measured results" << std::endl
+	    << "  --tolerance <m>=<f>    relative tolerance for metric m (e.g. events_per_s=0.2)" << std::endl
+	    << "  --list                 list the benchmarks in the macros directory and the metrics" << std::endl
+	    << "exit code 1 on failure or regression, 77 if a benchmark has no baseline" << std::endl;
+}
+
+/*****************************************************************/
+
+std::vector<std::string>
+listBenchmarks(const std::string &macros)
+{
+  std::vector<std::string> benchmarks;
+  auto dir = opendir(macros.c_str());
+  if (!dir) return benchmarks;
+  while (auto entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() < 5 || name.compare(name.size() - 4, 4, ".mac") != 0) continue;
+    std::ifstream fin(macros + "/" + name);
+    std::string line;
+    if (!std::getline(fin, line) || line.compare(0, gBenchmarkTag.size(), gBenchmarkTag) != 0) continue;
+    benchmarks.push_back(name.substr(0, name.size() - 4));
+  }
+  closedir(dir);
+  std::sort(benchmarks.begin(), benchmarks.end());
+  return benchmarks;
+}
+
+/*****************************************************************/
+
+double
+now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*****************************************************************/
+
+bool
+parseMacro(const std::string &filename, long &nevents, std::string &prefix)
+{
+  std::ifstream fin(filename);
+  if (!fin.is_open()) return false;
+  std::string line, command;
+  while (std::getline(fin, line)) {
+    std::istringstream iss(line);
+    if (!(iss >> command)) continue;
+    if (command == "/run/beamOn") iss >> nevents;
+    else if (command == "/io/prefix") iss >> prefix;
+  }
+  return true;
+}
+
+/*****************************************************************/
+
+/** minimal reader for the flat { "bench": { "metric": value } } files written below **/
+
+void
+skipSpaces(const std::string &s, size_t &i)
+{
+  while (i < s.size() && isspace(s[i])) i++;
+}
+
+bool
+readString(const std::string &s, size_t &i, std::string &out)
+{
+  skipSpaces(s, i);
+  if (i >= s.size() || s[i] != '"') return false;
+  auto end = s.find('"', i + 1);
+  if (end == std::string::npos) return false;
+  out = s.substr(i + 1, end - i - 1);
+  i = end + 1;
+  return true;
+}
+
+bool
+expect(const std::string &s, size_t &i, char c)
+{
+  skipSpaces(s, i);
+  if (i >= s.size() || s[i] != c) return false;
+  i++;
+  return true;
+}
+
+bool
+readJSON(const std::string &filename, Results_t &results)
+{
+  std::ifstream fin(filename);
+  if (!fin.is_open()) return false;
+  std::stringstream buffer;
+  buffer << fin.rdbuf();
+  auto s = buffer.str();
+  size_t i = 0;
+  if (!expect(s, i, '{')) return false;
+  if (expect(s, i, '}')) return true;
+  do {
+    std::string bench, metric;
+    if (!readString(s, i, bench) || !expect(s, i, ':') || !expect(s, i, '{')) return false;
+    if (expect(s, i, '}')) continue;
+    do {
+      if (!readString(s, i, metric) || !expect(s, i, ':')) return false;
+      skipSpaces(s, i);
+      char *end;
+      results[bench][metric] = std::strtod(s.c_str() + i, &end);
+      if (end == s.c_str() + i) return false;
+      i = end - s.c_str();
+    } while (expect(s, i, ','));
+    if (!expect(s, i, '}')) return false;
+  } while (expect(s, i, ','));
+  return expect(s, i, '}');
+}
+
+/*****************************************************************/
+
+bool
+writeJSON(const std::string &filename, const Results_t &results)
+{
+  std::ofstream fout(filename);
+  if (!fout.is_open()) return false;
+  fout << "{";
+  bool firstBench = true;
+  for (const auto &bench : results) {
+    fout << (firstBench ? "\n" : ",\n") << "  \"" << bench.first << "\": {";
+    bool firstMetric = true;
+    for (const auto &metric : bench.second) {
+      fout << (firstMetric ? "\n" : ",\n") << "    \"" << metric.first << "\": " << metric.second;
+      firstMetric = false;
+    }
+    fout << "\n  }";
+    firstBench = false;
+  }
+  fout << "\n}" << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+runBenchmark(const std::string &name, const std::string &g4me, const std::string &share,
+	     const std::string &macros, Metrics_t &metrics)
+{
+  auto macro = macros + "/" + name + ".mac";
+  long nevents = 0;
+  std::string prefix = "g4me";
+  if (!parseMacro(macro, nevents, prefix) || nevents <= 0) {
+    std::cout << " --- cannot read events from macro: " << macro << std::endl;
+    return false;
+  }
+
+  /** each benchmark runs in its own working directory **/
+  mkdir(name.c_str(), 0755);
+  auto output = name + "/" + prefix + ".000.root";
+  std::remove(output.c_str());
+
+  int fd[2];
+  if (pipe(fd) != 0) return false;
+  auto tfork = now();
+  auto pid = fork();
+  if (pid < 0) return false;
+  if (pid == 0) {
+    dup2(fd[1], STDOUT_FILENO);
+    close(fd[0]);
+    close(fd[1]);
+    if (chdir(name.c_str()) != 0) _exit(127);
+    setenv("G4ME_SHARE", share.c_str(), 1);
+    setenv("G4ME_BENCH", macros.c_str(), 1);
+    execlp(g4me.c_str(), g4me.c_str(), macro.c_str(), (char *)nullptr);
+    _exit(127);
+  }
+  close(fd[1]);
+
+  /** timestamps from the run action printouts **/
+  double tstart = 0., tend = 0.;
+  auto fin = fdopen(fd[0], "r");
+  auto log = std::ofstream(name + "/g4me.log");
+  char line[4096];
+  while (std::fgets(line, sizeof(line), fin)) {
+    if (!tstart && std::strncmp(line, "--- start of run", 16) == 0) tstart = now();
+    if (!tend && std::strncmp(line, "--- end of run", 14) == 0) tend = now();
+    log << line;
+  }
+  std::fclose(fin);
+
+  int status;
+  struct rusage usage;
+  wait4(pid, &status, 0, &usage);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !tstart || !tend) {
+    std::cout << " --- benchmark failed: " << name << " (see " << name << "/g4me.log)" << std::endl;
+    return false;
+  }
+
+  struct stat st;
+  double bytes = stat(output.c_str(), &st) == 0 ? st.st_size : 0.;
+  metrics["events_per_s"] = nevents / (tend - tstart);
+  metrics["peak_rss_mb"] = usage.ru_maxrss / 1024.; // kB on Linux
+  metrics["bytes_per_event"] = bytes / nevents;
+  metrics["startup_s"] = tstart - tfork;
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+compare(const std::string &name, const Metrics_t &measured, const Results_t &baseline)
+{
+  auto it = baseline.find(name);
+  if (it == baseline.end()) {
+    std::cout << " --- " << name << ": no baseline" << std::endl;
+    for (const auto &metric : gMetrics)
+      std::cout << "     " << metric.name << " = " << measured.at(metric.name) << std::endl;
+    return true;
+  }
+
+  bool ok = true;
+  std::cout << " --- " << name << ": comparison with baseline" << std::endl;
+  for (const auto &metric : gMetrics) {
+    auto value = measured.at(metric.name);
+    auto reference = it->second.find(metric.name);
+    if (reference == it->second.end() || reference->second == 0.) {
+      std::cout << "     " << metric.name << " = " << value << " (no reference)" << std::endl;
+      continue;
+    }
+    auto change = value / reference->second - 1.;
+    auto regression = metric.higherIsBetter ? -change : change;
+    auto pass = regression <= metric.tolerance;
+    std::cout << "     " << metric.name << " = " << value
+	      << " (baseline " << reference->second << ", " << (change >= 0. ? "+" : "") << change * 100. << "%)"
+	      << (pass ? "" : " REGRESSION") << std::endl;
+    ok = ok && pass;
+  }
+  return ok;
+}
+
+/*****************************************************************/
+
+int
+main(int argc, char **argv)
+{
+  std::string g4me = "g4me", share = ".", macros = ".", baselineFile, outputFile;
+  bool update = false, list = false;
+  std::vector<std::string> benchmarks;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      if (i + 1 >= argc) { usage(); exit(1); }
+      return argv[++i];
+    };
+    if (arg == "--g4me") g4me = next();
+    else if (arg == "--share") share = next();
+    else if (arg == "--macros") macros = next();
+    else if (arg == "--baseline") baselineFile = next();
+    else if (arg == "--output") outputFile = next();
+    else if (arg == "--update") update = true;
+    else if (arg == "--tolerance") {
+      auto value = next();
+      auto pos = value.find('=');
+      bool found = false;
+      for (auto &metric : gMetrics) {
+	if (pos == std::string::npos || value.substr(0, pos) != metric.name) continue;
+	metric.tolerance = std::atof(value.c_str() + pos + 1);
+	found = true;
+      }
+      if (!found) {
+	std::cout << " --- unknown tolerance: " << value << std::endl;
+	return 1;
+      }
+    }
+    else if (arg == "--list") list = true;
+    else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+    else benchmarks.push_back(arg);
+  }
+  if (list) {
+    std::cout << " --- benchmarks:";
+    for (const auto &bench : listBenchmarks(macros)) std::cout << " " << bench;
+    std::cout << std::endl << " --- metrics (tolerance):";
+    for (const auto &metric : gMetrics) std::cout << " " << metric.name << " (" << metric.tolerance << ")";
+    std::cout << std::endl;
+    return 0;
+  }
+  if (benchmarks.empty()) benchmarks = listBenchmarks(macros);
+  if (benchmarks.empty()) {
+    std::cout << " --- no benchmark macros in " << macros << std::endl;
+    return 1;
+  }
+
+  /** macros are executed from the benchmark working directory **/
+  char cwd[4096];
+  if (share[0] != '/' && getcwd(cwd, sizeof(cwd))) share = std::string(cwd) + "/" + share;
+  if (macros[0] != '/' && getcwd(cwd, sizeof(cwd))) macros = std::string(cwd) + "/" + macros;
+
+  Results_t baseline, measured;
+  if (!baselineFile.empty() && !readJSON(baselineFile, baseline) && !update) {
+    std::cout << " --- cannot read baseline: " << baselineFile << std::endl;
+    return 1;
+  }
+
+  bool ok = true, missing = false;
+  for (const auto &bench : benchmarks) {
+    std::cout << " --- running benchmark: " << bench << std::endl;
+    if (!runBenchmark(bench, g4me, share, macros, measured[bench])) {
+      measured.erase(bench);
+      ok = false;
+      continue;
+    }
+    if (update) continue;
+    ok = compare(bench, measured[bench], baseline) && ok;
+    missing = missing || baseline.find(bench) == baseline.end();
+  }
+
+  if (!outputFile.empty()) writeJSON(outputFile, measured);
+  if (update && !baselineFile.empty()) {
+    for (const auto &bench : measured) baseline[bench.first] = bench.second;
+    writeJSON(baselineFile, baseline);
+    std::cout << " --- baseline updated: " << baselineFile << std::endl;
+  }
+
+  /** without baseline nothing was checked, CTest reports it as not run **/
+  if (!ok) return 1;
+  return missing ? 77 : 0;
+}
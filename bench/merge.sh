@@ -0,0 +1,34 @@
+#! /usr/bin/env bash
+### @author: Roberto Preghenella
+### @email: preghenella@bo.infn.it
+
+### merge throughput of g4me-merge vs hadd
+### usage: merge.sh <file.root> [copies] [jobs]
+### the file is replicated to build a realistic set of job outputs
+
+FILE=$1
+COPIES=${2:-16}
+JOBS=${3:-4}
+[ -f "$FILE" ] || { echo "usage: merge.sh <file.root> [copies] [jobs]"; exit 1; }
+
+WORKDIR=$(mktemp -d merge.XXXX)
+for I in $(seq -f "%03g" 0 $((COPIES - 1))); do
+    cp "$FILE" $WORKDIR/input.job$I.root
+done
+BYTES=$(du -cb $WORKDIR/input.job*.root | tail -1 | cut -f1)
+
+measure() {
+    local NAME=$1; shift
+    rm -f $WORKDIR/output.root
+    local START=$(date +%s.%N)
+    "$@" > /dev/null 2>&1 || { echo " --- $NAME failed"; return; }
+    local END=$(date +%s.%N)
+    echo "$NAME $START $END $BYTES" | awk '{ t = $3 - $2; printf(" --- %-16s %8.3f s %10.1f MB/s\n", $1, t, $4 / 1048576. / t) }'
+}
+
+measure "hadd"            hadd -f $WORKDIR/output.root $WORKDIR/input.job*.root
+measure "hadd -j"         hadd -f -j $JOBS $WORKDIR/output.root $WORKDIR/input.job*.root
+measure "g4me-merge"      g4me-merge --jobs $JOBS $WORKDIR/output.root $WORKDIR/input.job*.root
+measure "g4me-merge -c"   g4me-merge --jobs $JOBS --cluster 100 $WORKDIR/output.root $WORKDIR/input.job*.root
+
+rm -rf $WORKDIR
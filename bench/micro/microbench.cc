@@ -0,0 +1,219 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/** g4me-microbench: nanoseconds per call of the I/O and
+    classification hot paths with synthetic tracks and steps **/
+
+#include "RootIO.hh"
+#include "StackingAction.hh"
+#include "SensitiveDetector.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4Event.hh"
+#include "G4StepPoint.hh"
+#include "G4DynamicParticle.hh"
+#include "G4PionPlus.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4NistManager.hh"
+#include "G4Box.hh"
+#include "G4Tubs.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PVPlacement.hh"
+#include "G4Navigator.hh"
+#include "G4TouchableHistory.hh"
+#include "G4UImanager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <benchmark/benchmark.h>
+
+using namespace G4me;
+
+/*****************************************************************/
+
+/** one silicon layer in a world of air,
+    enough to give the steps a touchable with a copy number **/
+
+struct Geometry_t {
+  G4VPhysicalVolume *world;
+  G4Navigator navigator;
+  Geometry_t() {
+    auto nist = G4NistManager::Instance();
+    auto world_s = new G4Box("world_s", 1. * m, 1. * m, 1. * m);
+    auto world_lv = new G4LogicalVolume(world_s, nist->FindOrBuildMaterial("G4_AIR"), "world_lv");
+    world = new G4PVPlacement(nullptr, G4ThreeVector(), world_lv, "world_pv", nullptr, false, 0);
+    auto layer_s = new G4Tubs("layer_s", 1.8 * cm, 1.805 * cm, 100. * cm, 0., 2. * M_PI);
+    auto layer_lv = new G4LogicalVolume(layer_s, nist->FindOrBuildMaterial("G4_Si"), "layer_lv");
+    new G4PVPlacement(nullptr, G4ThreeVector(), layer_lv, "layer_pv", world_lv, false, 3);
+    navigator.SetWorldVolume(world);
+  };
+};
+
+Geometry_t &
+geometry()
+{
+  static Geometry_t geometry;
+  return geometry;
+}
+
+/*****************************************************************/
+
+/** a track with its step, pre-step point in the layer **/
+
+struct Synthetic_t {
+  G4Track *track;
+  G4Step step;
+  Synthetic_t(G4ParticleDefinition *particle, double ekin) {
+    G4ThreeVector position(1.802 * cm, 0., 0.5 * cm);
+    G4ThreeVector direction = G4ThreeVector(1., 0., 0.3).unit();
+    track = new G4Track(new G4DynamicParticle(particle, direction, ekin), 0.1 * ns, position);
+    track->SetTrackID(1);
+    track->SetParentID(0);
+    track->SetStep(&step);
+    step.SetTrack(track);
+    step.SetTotalEnergyDeposit(10. * keV);
+    step.SetFirstStepFlag();
+    auto &navigator = geometry().navigator;
+    navigator.LocateGlobalPointAndSetup(position, &direction, false, false);
+    step.GetPreStepPoint()->SetTouchableHandle(G4TouchableHandle(navigator.CreateTouchableHistory()));
+    step.GetPreStepPoint()->SetPosition(position);
+    step.GetPostStepPoint()->SetPosition(position + 5. * um * direction);
+  };
+  ~Synthetic_t() { delete track; };
+};
+
+/*****************************************************************/
+
+static void
+BM_RootIO_AddTrack(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  Synthetic_t synthetic(G4PionPlus::Definition(), 1. * GeV);
+  int id = 0;
+  io->ResetTracks();
+  for (auto _ : state) {
+    synthetic.track->SetTrackID(++id);
+    io->AddTrack(synthetic.track);
+    if (id == 10000) { io->ResetTracks(); id = 0; }
+  }
+  io->ResetTracks();
+}
+BENCHMARK(BM_RootIO_AddTrack);
+
+/*****************************************************************/
+
+static void
+BM_RootIO_AddHit(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  Synthetic_t synthetic(G4PionPlus::Definition(), 1. * GeV);
+  int n = 0;
+  io->ResetHits();
+  for (auto _ : state) {
+    io->AddHit(&synthetic.step);
+    if (++n == 10000) { io->ResetHits(); n = 0; }
+  }
+  io->ResetHits();
+}
+BENCHMARK(BM_RootIO_AddHit);
+
+/*****************************************************************/
+
+static void
+BM_RootIO_AddParticle(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  int id = 0;
+  io->ResetParticles();
+  for (auto _ : state) {
+    io->AddParticle(id, 211, -1, 0.3, 0.2, 1.1, 1.2, 0., 0., 0., 0.);
+    if (++id == 10000) { io->ResetParticles(); id = 0; }
+  }
+  io->ResetParticles();
+}
+BENCHMARK(BM_RootIO_AddParticle);
+
+/*****************************************************************/
+
+/** end-of-event fill path, argument is the number of tracks,
+    with two hits and one generator particle per track **/
+
+static void
+BM_RootIO_EndOfEvent(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  Synthetic_t synthetic(G4PionPlus::Definition(), 1. * GeV);
+  auto ntracks = state.range(0);
+  G4Event event(0);
+  io->Open("microbench.root");
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (int id = 0; id < ntracks; ++id) {
+      synthetic.track->SetTrackID(id + 1);
+      io->AddTrack(synthetic.track);
+      io->AddHit(&synthetic.step);
+      io->AddHit(&synthetic.step);
+      io->AddParticle(id, 211, -1, 0.3, 0.2, 1.1, 1.2, 0., 0., 0., 0.);
+    }
+    state.ResumeTiming();
+    io->EndOfEventAction(&event);
+  }
+  io->Close();
+  state.SetItemsProcessed(state.iterations() * ntracks);
+}
+BENCHMARK(BM_RootIO_EndOfEvent)->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+/*****************************************************************/
+
+/** argument 0: transport all, constant decision per particle
+    argument 1: energy-dependent kill rule evaluated per track **/
+
+static void
+BM_StackingAction_ClassifyNewTrack(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  static auto stacking = new StackingAction();
+  auto ui = G4UImanager::GetUIpointer();
+  ui->ApplyCommand("/stacking/transport none");
+  ui->ApplyCommand("/stacking/transport all");
+  if (state.range(0) == 1) ui->ApplyCommand("/stacking/rule kill e- 0. 1. MeV");
+  stacking->PrepareNewEvent();
+
+  Synthetic_t synthetic(G4Electron::Definition(), 5. * MeV);
+  int id = 0;
+  io->ResetTracks();
+  for (auto _ : state) {
+    synthetic.track->SetTrackID(++id);
+    benchmark::DoNotOptimize(stacking->ClassifyNewTrack(synthetic.track));
+    if (id == 10000) { io->ResetTracks(); id = 0; }
+  }
+  io->ResetTracks();
+}
+BENCHMARK(BM_StackingAction_ClassifyNewTrack)->Arg(0)->Arg(1);
+
+/*****************************************************************/
+
+/** argument 0: hit is recorded, argument 1: rejected by the angle cut **/
+
+static void
+BM_SensitiveDetector_ProcessHits(benchmark::State &state)
+{
+  auto io = RootIO::Instance();
+  static auto sd = new SensitiveDetector("microbench_sd");
+  Synthetic_t synthetic(G4PionPlus::Definition(), 1. * GeV);
+  if (state.range(0) == 1)
+    synthetic.track->SetMomentumDirection(G4ThreeVector(0., 1., 0.));
+  int n = 0;
+  io->ResetHits();
+  for (auto _ : state) {
+    sd->Hit(&synthetic.step);
+    if (++n == 10000) { io->ResetHits(); n = 0; }
+  }
+  io->ResetHits();
+}
+BENCHMARK(BM_SensitiveDetector_ProcessHits)->Arg(0)->Arg(1);
+
+/*****************************************************************/
+
+BENCHMARK_MAIN();
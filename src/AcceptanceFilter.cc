@@ -0,0 +1,184 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "AcceptanceFilter.hh"
+#include "DetectorConstruction.hh"
+#include "FieldSetup.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include <algorithm>
+
+namespace G4me {
+
+AcceptanceFilter *AcceptanceFilter::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+AcceptanceFilter::InitMessenger()
+{
+  mDirectory = new G4UIdirectory("/stacking/acceptance/");
+
+  mEnableCmd = new G4UIcmdWithABool("/stacking/acceptance/enable", this);
+  mEnableCmd->SetGuidance("Reject charged tracks whose helix cannot reach any tracker layer.");
+  mEnableCmd->SetGuidance("Energy loss and scattering are neglected, secondaries of rejected tracks are lost.");
+  mEnableCmd->SetGuidance("The field is assumed uniform, the filter is disabled with a field map.");
+  mEnableCmd->SetParameterName("enable", false);
+  mEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mModeCmd = new G4UIcmdWithAString("/stacking/acceptance/mode", this);
+  mModeCmd->SetGuidance("Kill the rejected tracks or move them to the waiting stack.");
+  mModeCmd->SetParameterName("mode", false);
+  mModeCmd->SetCandidates("kill wait");
+  mModeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mPerStepCmd = new G4UIcmdWithABool("/stacking/acceptance/perStep", this);
+  mPerStepCmd->SetGuidance("Repeat the check at every step and kill the track when rejected.");
+  mPerStepCmd->SetParameterName("perStep", false);
+  mPerStepCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMarginCmd = new G4UIcmdWithADoubleAndUnit("/stacking/acceptance/margin", this);
+  mMarginCmd->SetGuidance("Radial safety margin added to the helix extent.");
+  mMarginCmd->SetParameterName("margin", false);
+  mMarginCmd->SetUnitCategory("Length");
+  mMarginCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+AcceptanceFilter::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mEnableCmd)
+    mEnabled = mEnableCmd->GetNewBoolValue(value);
+  if (command == mModeCmd)
+    mWaitMode = (value.compare("wait") == 0);
+  if (command == mPerStepCmd)
+    mPerStep = mPerStepCmd->GetNewBoolValue(value);
+  if (command == mMarginCmd)
+    mMargin = mMarginCmd->GetNewDoubleValue(value);
+}
+
+/*****************************************************************/
+
+void
+AcceptanceFilter::BeginOfRunAction(const G4Run *aRun)
+{
+  mChecked = mRejectedStacking = mRejectedStepping = 0;
+  mChargedTracks = mChargedSteps = 0;
+  mActive = false;
+  if (!mEnabled) return;
+
+  /** the field is assumed uniform along z, not true with a map **/
+  if (FieldSetup::Instance()->HasFieldMap()) {
+    std::cout << " --- acceptance filter: not valid with a field map, disabled" << std::endl;
+    return;
+  }
+  mBz = FieldSetup::GetBzAtOrigin();
+  
+  /** layer radii from the detector construction **/
+  mLayerRmin.clear();
+  mLayerRmax.clear();
+  auto detector = dynamic_cast<const DetectorConstruction *>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (detector) {
+    auto layers = detector->GetTrackerLayers();
+    std::sort(layers.begin(), layers.end(),
+	      [](std::map<std::string, double> &a, std::map<std::string, double> &b) { return a["radius"] < b["radius"]; });
+    for (auto layer : layers) {
+      mLayerRmin.push_back(layer["radius"] - 0.5 * layer["thickness"]);
+      mLayerRmax.push_back(layer["radius"] + 0.5 * layer["thickness"]);
+    }
+  }
+
+  if (mBz == 0. || mLayerRmin.empty()) {
+    std::cout << " --- acceptance filter: no field or no layers, disabled for this run" << std::endl;
+    return;
+  }
+  mActive = true;
+#ifndef G4ME_STEPPING_ACTION
+  if (mPerStep) std::cout << " --- acceptance filter: stepping action not built, per-step check is ignored" << std::endl;
+  mPerStep = false;
+#endif
+  std::cout << " --- acceptance filter: Bz = " << mBz / tesla << " T, "
+	    << mLayerRmin.size() << " layers, mode = " << (mWaitMode ? "wait" : "kill")
+	    << (mPerStep ? ", per step" : "") << std::endl;
+}
+
+/*****************************************************************/
+
+void
+AcceptanceFilter::EndOfRunAction(const G4Run *aRun)
+{
+  if (!mActive) return;
+  double stepsPerTrack = mChargedTracks > 0 ? (double)mChargedSteps / (double)mChargedTracks : 0.;
+  std::cout << " --- acceptance filter report " << std::endl
+	    << "     checked tracks      = " << mChecked << std::endl
+	    << "     rejected (stacking) = " << mRejectedStacking << std::endl
+	    << "     rejected (stepping) = " << mRejectedStepping << std::endl
+	    << "     charged steps/track = " << stepsPerTrack << std::endl
+	    << "     steps saved (est.)  = " << (long)(stepsPerTrack * mRejectedStacking) << std::endl;
+}
+
+/*****************************************************************/
+
+bool
+AcceptanceFilter::CanReachLayer(const G4Track *aTrack) const
+{
+  auto charge = aTrack->GetDynamicParticle()->GetCharge();
+  if (charge == 0.) return true;
+  const auto &momentum = aTrack->GetMomentum();
+  auto pt = momentum.perp();
+  if (pt == 0.) return true;
+
+  /** radius and centre of the transverse circle **/
+  const auto &position = aTrack->GetPosition();
+  auto radius = pt / (std::fabs(charge) * c_light * std::fabs(mBz));
+  auto sign = (charge * mBz > 0.) ? radius / pt : -radius / pt;
+  auto cx = position.x() + sign * momentum.y();
+  auto cy = position.y() - sign * momentum.x();
+  auto rc = std::sqrt(cx * cx + cy * cy);
+  auto rmin = std::fabs(rc - radius) - mMargin;
+  auto rmax = rc + radius + mMargin;
+
+  /** first layer not entirely inside rmin **/
+  auto it = std::lower_bound(mLayerRmax.begin(), mLayerRmax.end(), rmin);
+  if (it == mLayerRmax.end()) return false;
+  return mLayerRmin[it - mLayerRmax.begin()] <= rmax;
+}
+
+/*****************************************************************/
+
+bool
+AcceptanceFilter::AcceptTrack(const G4Track *aTrack)
+{
+  mChecked++;
+  if (CanReachLayer(aTrack)) return true;
+  mRejectedStacking++;
+  return false;
+}
+
+/*****************************************************************/
+
+void
+AcceptanceFilter::Step(const G4Step *aStep)
+{
+  auto track = aStep->GetTrack();
+  if (track->GetDynamicParticle()->GetCharge() == 0.) return;
+  if (track->GetCurrentStepNumber() == 1) mChargedTracks++;
+  mChargedSteps++;
+  if (!mPerStep || CanReachLayer(track)) return;
+  track->SetTrackStatus(fStopAndKill);
+  mRejectedStepping++;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,79 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _AcceptanceFilter_h_
+#define _AcceptanceFilter_h_
+
+#include "G4UImessenger.hh"
+#include <vector>
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4UIcmdWithAString;
+class G4UIcmdWithADoubleAndUnit;
+class G4Run;
+class G4Track;
+class G4Step;
+
+namespace G4me {
+
+/** analytic helix check in the uniform solenoidal field,
+    tracks whose transverse circle does not cross any
+    sensitive layer cannot produce hits **/
+  
+class AcceptanceFilter : public G4UImessenger
+{
+  
+public:
+
+  static AcceptanceFilter *Instance() {
+    if (!mInstance) mInstance = new AcceptanceFilter();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void BeginOfRunAction(const G4Run *aRun);
+  void EndOfRunAction(const G4Run *aRun);
+
+  bool IsEnabled() const { return mEnabled && mActive; };
+  bool IsWaitMode() const { return mWaitMode; };
+  
+  bool AcceptTrack(const G4Track *aTrack);
+  void Step(const G4Step *aStep);
+  
+private:
+
+  AcceptanceFilter() = default;
+
+  bool CanReachLayer(const G4Track *aTrack) const;
+  
+  static AcceptanceFilter *mInstance;
+
+  bool mEnabled = false;
+  bool mActive = false;
+  bool mWaitMode = false;
+  bool mPerStep = false;
+  double mMargin = 0.;
+  double mBz = 0.;
+  std::vector<double> mLayerRmin; // sorted
+  std::vector<double> mLayerRmax;
+
+  long mChecked = 0;
+  long mRejectedStacking = 0;
+  long mRejectedStepping = 0;
+  long mChargedTracks = 0;
+  long mChargedSteps = 0;
+  
+  G4UIdirectory *mDirectory;
+  G4UIcmdWithABool *mEnableCmd;
+  G4UIcmdWithAString *mModeCmd;
+  G4UIcmdWithABool *mPerStepCmd;
+  G4UIcmdWithADoubleAndUnit *mMarginCmd;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _AcceptanceFilter_h_ **/
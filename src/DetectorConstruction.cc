@@ -5,22 +5,49 @@
 #include "SensitiveDetector.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4NistManager.hh"
+#ifdef G4ME_USE_VECGEOM
+#include "G4UBox.hh"
+#include "G4UTubs.hh"
+#else
 #include "G4Box.hh"
 #include "G4Tubs.hh"
+#endif
 #include "G4LogicalVolume.hh"
 #include "G4LogicalVolumeStore.hh"
 #include "G4PVPlacement.hh"
-#include "G4GlobalMagFieldMessenger.hh"
-#include "G4AutoDelete.hh"
+#include "FieldSetup.hh"
 #include "G4SDManager.hh"
 #include "G4MaterialPropertiesTable.hh"
 #include "G4String.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4UserLimits.hh"
+#include "G4RunManagerKernel.hh"
+#include "G4VUserPhysicsList.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4StepLimiterPhysics.hh"
+#include "G4StateManager.hh"
 
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include <numeric>
+#include <algorithm>
 
 namespace G4me {
 
+/** solids, VecGeom implementations when requested at build time **/
+#ifdef G4ME_USE_VECGEOM
+typedef G4UBox Box_t;
+typedef G4UTubs Tubs_t;
+#else
+typedef G4Box Box_t;
+typedef G4Tubs Tubs_t;
+#endif
+
 /*****************************************************************/
 
 DetectorConstruction::DetectorConstruction()
@@ -34,6 +61,16 @@ DetectorConstruction::DetectorConstruction()
   , mPipeThickness(500 * um)
   , mTrackerDirectory(nullptr)
   , mTrackerAddLayerCmd(nullptr)
+  , mTrackerEnvelopesCmd(nullptr)
+  , mTrackerEnvelopeMaterialCmd(nullptr)
+  , mTrackerEnvelopeLayersCmd(nullptr)
+  , mTrackerEnvelopes(false)
+  , mTrackerEnvelopeMaterial("air")
+  , mTrackerEnvelopeLayers(4)
+  , mTrackerEnvelopeCopy(0)
+  , mRegionsDirectory(nullptr)
+  , mRegionsSetCutCmd(nullptr)
+  , mRegionsSetLimitCmd(nullptr)
 {
 
   mDetectorDirectory = new G4UIdirectory("/detector/");
@@ -73,6 +110,52 @@ DetectorConstruction::DetectorConstruction()
   mTrackerAddLayerCmd->SetParameter(new G4UIparameter("thickness", 'd', false));
   mTrackerAddLayerCmd->SetParameter(new G4UIparameter("unit", 's', false));
   mTrackerAddLayerCmd->AvailableForStates(G4State_PreInit);
+
+  mTrackerEnvelopesCmd = new G4UIcmdWithABool("/detector/tracker/envelopes", this);
+  mTrackerEnvelopesCmd->SetGuidance("Place the layers in nested envelopes, split at the largest radial gaps.");
+  mTrackerEnvelopesCmd->SetParameterName("envelopes", false);
+  mTrackerEnvelopesCmd->AvailableForStates(G4State_PreInit);
+
+  mTrackerEnvelopeMaterialCmd = new G4UIcmdWithAString("/detector/tracker/envelopeMaterial", this);
+  mTrackerEnvelopeMaterialCmd->SetGuidance("Material of the envelopes.");
+  mTrackerEnvelopeMaterialCmd->SetParameterName("material", false);
+  mTrackerEnvelopeMaterialCmd->SetCandidates("air vacuum");
+  mTrackerEnvelopeMaterialCmd->AvailableForStates(G4State_PreInit);
+
+  mTrackerEnvelopeLayersCmd = new G4UIcmdWithAnInteger("/detector/tracker/envelopeLayers", this);
+  mTrackerEnvelopeLayersCmd->SetGuidance("Maximum number of layers in an envelope before it is split.");
+  mTrackerEnvelopeLayersCmd->SetParameterName("layers", false);
+  mTrackerEnvelopeLayersCmd->SetRange("layers > 0");
+  mTrackerEnvelopeLayersCmd->AvailableForStates(G4State_PreInit);
+
+  /** regions **/
+
+  mRegionsDirectory = new G4UIdirectory("/detector/regions/");
+
+  mRegionsSetCutCmd = new G4UIcommand("/detector/regions/setCut", this);
+  mRegionsSetCutCmd->SetGuidance("Set the production cut of a particle in a region.");
+  mRegionsSetCutCmd->SetGuidance("The world cuts are those of the physics list, /run/setCut overrides them.");
+  auto parameter = new G4UIparameter("region", 's', false);
+  parameter->SetParameterCandidates("world pipe tracker");
+  mRegionsSetCutCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("particle", 's', false);
+  parameter->SetParameterCandidates("all gamma e- e+ proton");
+  mRegionsSetCutCmd->SetParameter(parameter);
+  mRegionsSetCutCmd->SetParameter(new G4UIparameter("cut", 'd', false));
+  mRegionsSetCutCmd->SetParameter(new G4UIparameter("unit", 's', false));
+  mRegionsSetCutCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mRegionsSetLimitCmd = new G4UIcommand("/detector/regions/setLimit", this);
+  mRegionsSetLimitCmd->SetGuidance("Set a user limit in a region.");
+  parameter = new G4UIparameter("region", 's', false);
+  parameter->SetParameterCandidates("world pipe tracker");
+  mRegionsSetLimitCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("limit", 's', false);
+  parameter->SetParameterCandidates("maxStep maxTrack maxTime minEkin minRange");
+  mRegionsSetLimitCmd->SetParameter(parameter);
+  mRegionsSetLimitCmd->SetParameter(new G4UIparameter("value", 'd', false));
+  mRegionsSetLimitCmd->SetParameter(new G4UIparameter("unit", 's', false));
+  mRegionsSetLimitCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 /*****************************************************************/
@@ -104,6 +187,111 @@ DetectorConstruction::SetNewValue(G4UIcommand *command, G4String value)
     G4double thickness = command->ConvertToDimensionedDouble(G4String(thickness_value + ' ' + thickness_unit));
     mTrackerLayer.push_back({ {"radius", radius}, {"length", length}, {"thickness", thickness} });
   }
+  if (command == mTrackerEnvelopesCmd)
+    mTrackerEnvelopes = mTrackerEnvelopesCmd->GetNewBoolValue(value);
+  if (command == mTrackerEnvelopeMaterialCmd)
+    mTrackerEnvelopeMaterial = value;
+  if (command == mTrackerEnvelopeLayersCmd)
+    mTrackerEnvelopeLayers = mTrackerEnvelopeLayersCmd->GetNewIntValue(value);
+  if (command == mRegionsSetCutCmd || command == mRegionsSetLimitCmd) {
+    G4String region, name, value_value, value_unit;
+    std::istringstream iss(value);
+    iss >> region >> name >> value_value >> value_unit;
+    G4double val = command->ConvertToDimensionedDouble(G4String(value_value + ' ' + value_unit));
+    if (command == mRegionsSetCutCmd) mRegionCuts[region][name] = val;
+    if (command == mRegionsSetLimitCmd) {
+      RegisterStepLimiter();
+      if (!mStepLimiter) return;
+      mRegionLimits[region][name] = val;
+    }
+    /** regions exist already after initialisation **/
+    if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle) {
+      if (command == mRegionsSetCutCmd) ApplyRegionCuts(region);
+      if (command == mRegionsSetLimitCmd) ApplyRegionLimits(region);
+    }
+  }
+}
+
+/*****************************************************************/
+
+void
+DetectorConstruction::RegisterStepLimiter()
+{
+  /** the user limits need the step limiter and special cuts processes,
+      which are added to the physics only when a limit is set, not to
+      query them at every step of every track for nothing **/
+  if (mStepLimiter) return;
+  auto physics = dynamic_cast<G4VModularPhysicsList *>(G4RunManagerKernel::GetRunManagerKernel()->GetPhysicsList());
+  if (!physics || G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit) {
+    std::cout << " --- regions: user limits need /detector/regions/setLimit before /run/initialize, ignored" << std::endl;
+    return;
+  }
+  physics->RegisterPhysics(new G4StepLimiterPhysics());
+  mStepLimiter = true;
+}
+
+/*****************************************************************/
+
+G4Region *
+DetectorConstruction::GetRegion(const std::string &name) const
+{
+  if (name.compare("world") == 0)
+    return G4RegionStore::GetInstance()->GetRegion("DefaultRegionForTheWorld", false);
+  return G4RegionStore::GetInstance()->GetRegion(name, false);
+}
+
+/*****************************************************************/
+
+void
+DetectorConstruction::ApplyRegionCuts(const std::string &name)
+{
+  auto region = GetRegion(name);
+  auto physics = G4RunManagerKernel::GetRunManagerKernel()->GetPhysicsList();
+  if (!region || !physics) return;
+
+  /** the cuts of the world are owned by the physics list,
+      setting the default value explicitly prevents that they
+      are reset when the physics list is initialised **/
+  if (name.compare("world") == 0) {
+    if (!mRegionCuts[name].count("all"))
+      physics->SetDefaultCutValue(physics->GetDefaultCutValue());
+    for (const auto &cut : mRegionCuts[name]) {
+      if (cut.first.compare("all") == 0) physics->SetDefaultCutValue(cut.second);
+      else physics->SetCutValue(cut.second, cut.first);
+    }
+    return;
+  }
+
+  auto cuts = region->GetProductionCuts();
+  if (!cuts) {
+    cuts = new G4ProductionCuts();
+    cuts->SetProductionCut(physics->GetDefaultCutValue());
+    region->SetProductionCuts(cuts);
+  }
+  for (const auto &cut : mRegionCuts[name]) { // "all" comes first
+    if (cut.first.compare("all") == 0) cuts->SetProductionCut(cut.second);
+    else cuts->SetProductionCut(cut.second, cut.first);
+  }
+}
+
+/*****************************************************************/
+
+void
+DetectorConstruction::ApplyRegionLimits(const std::string &name)
+{
+  auto region = GetRegion(name);
+  if (!region) return;
+
+  auto &limits = mRegionUserLimits[name];
+  if (!limits) limits = new G4UserLimits();
+  for (const auto &limit : mRegionLimits[name]) {
+    if (limit.first.compare("maxStep") == 0) limits->SetMaxAllowedStep(limit.second);
+    if (limit.first.compare("maxTrack") == 0) limits->SetUserMaxTrackLength(limit.second);
+    if (limit.first.compare("maxTime") == 0) limits->SetUserMaxTime(limit.second);
+    if (limit.first.compare("minEkin") == 0) limits->SetUserMinEkine(limit.second);
+    if (limit.first.compare("minRange") == 0) limits->SetUserMinRange(limit.second);
+  }
+  region->SetUserLimits(limits);
 }
   
 /*****************************************************************/
@@ -116,10 +304,9 @@ DetectorConstruction::Construct() {
   auto vacuum = nist->FindOrBuildMaterial("G4_Galactic");
   auto air = nist->FindOrBuildMaterial("G4_AIR");
   auto be = nist->FindOrBuildMaterial("G4_Be");
-  auto si = nist->FindOrBuildMaterial("G4_Si");
   
   /** world **/
-  auto world_s  = new G4Box("world_s", 1.5 * m, 1.5 * m, 3.0 * m);
+  auto world_s  = new Box_t("world_s", 1.5 * m, 1.5 * m, 3.0 * m);
   auto world_lv = new G4LogicalVolume(world_s, air, "world_lv");
   auto world_pv = new G4PVPlacement(0,                // no rotation
 				    G4ThreeVector(),  // at (0,0,0)
@@ -140,7 +327,7 @@ DetectorConstruction::Construct() {
   
 
 #if 0
-  auto vacuum_s = new G4Tubs("vacuum_s",
+  auto vacuum_s = new Tubs_t("vacuum_s",
 			     0.,
 			     mPipeRadius - 0.5 * mPipeThickness,
 			     mPipeLength,
@@ -158,7 +345,7 @@ DetectorConstruction::Construct() {
 				     false);  
 #endif
   
-  auto pipe_s = new G4Tubs("pipe_s",
+  auto pipe_s = new Tubs_t("pipe_s",
 			   mPipeRadius - 0.5 * mPipeThickness,
 			   mPipeRadius + 0.5 * mPipeThickness,
 			   mPipeLength,
@@ -175,6 +362,9 @@ DetectorConstruction::Construct() {
 				   0,
 				   false);  
 
+  auto pipe_region = new G4Region("pipe");
+  pipe_region->AddRootLogicalVolume(pipe_lv);
+
   /** silicon tracker **/
 
   G4cout << " --- constructing silicon tracker " << G4endl
@@ -194,7 +384,7 @@ DetectorConstruction::Construct() {
   double thickness[10] = {50., 50., 50., 500., 500., 500., 500., 500., 500., 500.};
   for (int i = 0; i < 10; ++i) {
 
-    auto layer_s = new G4Tubs("layer_s",
+    auto layer_s = new Tubs_t("layer_s",
 			      radius[i] * cm - 0.5 * thickness[i] * um,
 			      radius[i] * cm + 0.5 * thickness[i] * um,
 			      100. * cm,
@@ -214,30 +404,115 @@ DetectorConstruction::Construct() {
   }
 #endif
   
-  int ilayer = 0;
-  for (auto layer : mTrackerLayer) {
-    
-    auto layer_s = new G4Tubs("layer_s",
-			      layer["radius"] - 0.5 * layer["thickness"],
-			      layer["radius"] + 0.5 * layer["thickness"],
-			      layer["length"],
-			      0., 2. * M_PI);
+  auto tracker_region = mTrackerLayer.empty() ? nullptr : new G4Region("tracker");
+  if (mTrackerEnvelopes && !mTrackerLayer.empty()) {
+    /** the envelopes follow the radial order, the copy number stays the addLayer index **/
+    std::vector<int> layers(mTrackerLayer.size());
+    std::iota(layers.begin(), layers.end(), 0);
+    std::sort(layers.begin(), layers.end(), [this](int a, int b) {
+	return mTrackerLayer[a]["radius"] < mTrackerLayer[b]["radius"]; });
+    mTrackerEnvelopeCopy = 0;
+    PlaceTrackerEnvelope(world_lv, layers, mPipeRadius + 0.5 * mPipeThickness, world_s->GetXHalfLength(), 0, tracker_region);
+    G4cout << "     envelopes = " << mTrackerEnvelopeCopy << " (" << mTrackerEnvelopeMaterial << ")" << G4endl;
+  }
+  else
+    for (int ilayer = 0; ilayer < mTrackerLayer.size(); ++ilayer)
+      PlaceTrackerLayer(world_lv, ilayer, tracker_region);
 
-    auto layer_lv = new G4LogicalVolume(layer_s, si, "layer_lv");
-    
-    auto layer_pv = new G4PVPlacement(nullptr,
-				      G4ThreeVector(0., 0., 0),
-				      layer_lv,
-				      "layer_pv",
-				      world_lv,
-				      false,
-				      ilayer,
-				      false);  
+  /** production cuts and user limits in regions **/
+  
+  for (const auto &cuts : mRegionCuts) ApplyRegionCuts(cuts.first);
+  for (const auto &limits : mRegionLimits) ApplyRegionLimits(limits.first);
+  
+  return world_pv;
+}
 
-    ++ilayer;
+/*****************************************************************/
+
+void
+DetectorConstruction::PlaceTrackerLayer(G4LogicalVolume *mother, int index, G4Region *region)
+{
+  auto &layer = mTrackerLayer[index];
+  auto si = G4NistManager::Instance()->FindOrBuildMaterial("G4_Si");
+  
+  auto layer_s = new Tubs_t("layer_s",
+			    layer["radius"] - 0.5 * layer["thickness"],
+			    layer["radius"] + 0.5 * layer["thickness"],
+			    layer["length"],
+			    0., 2. * M_PI);
+  
+  auto layer_lv = new G4LogicalVolume(layer_s, si, "layer_lv");
+  
+  auto layer_pv = new G4PVPlacement(nullptr,
+				    G4ThreeVector(0., 0., 0),
+				    layer_lv,
+				    "layer_pv",
+				    mother,
+				    false,
+				    index,
+				    false);  
+  
+  region->AddRootLogicalVolume(layer_lv);
+}
+
+/*****************************************************************/
+
+void
+DetectorConstruction::PlaceTrackerEnvelope(G4LogicalVolume *mother, const std::vector<int> &layers,
+					   double rmin, double rmax, int depth, G4Region *region)
+{
+  /** layers radially sorted, rmin and rmax are the free space around them.
+      the envelope takes a quarter of the free space on each side, so that
+      sibling envelopes never touch and are always inside their mother **/
+  auto inner = [this](int i) { return mTrackerLayer[i]["radius"] - 0.5 * mTrackerLayer[i]["thickness"]; };
+  auto outer = [this](int i) { return mTrackerLayer[i]["radius"] + 0.5 * mTrackerLayer[i]["thickness"]; };
+  
+  if (layers.size() == 1 && depth > 0) {
+    PlaceTrackerLayer(mother, layers[0], region);
+    return;
+  }
+
+  double length = 0.;
+  for (auto i : layers) length = std::max(length, mTrackerLayer[i]["length"]);
+  auto envelope_rmin = inner(layers.front()) - 0.25 * (inner(layers.front()) - rmin);
+  auto envelope_rmax = outer(layers.back()) + 0.25 * (rmax - outer(layers.back()));
+  auto material = G4NistManager::Instance()->FindOrBuildMaterial(mTrackerEnvelopeMaterial.compare("vacuum") == 0 ? "G4_Galactic" : "G4_AIR");
+
+  auto envelope_s = new Tubs_t("envelope_s",
+			       envelope_rmin,
+			       envelope_rmax,
+			       length + 1. * mm / (depth + 1),
+			       0., 2. * M_PI);
+
+  auto envelope_lv = new G4LogicalVolume(envelope_s, material, "envelope_lv");
+
+  auto envelope_pv = new G4PVPlacement(nullptr,
+				       G4ThreeVector(0., 0., 0),
+				       envelope_lv,
+				       "envelope_pv",
+				       mother,
+				       false,
+				       mTrackerEnvelopeCopy++,
+				       false);  
+
+  /** split at the largest radial gap **/
+  int split = -1;
+  double gap = 0.;
+  for (int k = 0; k + 1 < layers.size(); ++k) {
+    if (inner(layers[k + 1]) - outer(layers[k]) <= gap) continue;
+    gap = inner(layers[k + 1]) - outer(layers[k]);
+    split = k;
   }
   
-  return world_pv;
+  if (layers.size() <= mTrackerEnvelopeLayers || split < 0) {
+    for (auto i : layers) PlaceTrackerLayer(envelope_lv, i, region);
+    return;
+  }
+  
+  std::vector<int> below(layers.begin(), layers.begin() + split + 1);
+  std::vector<int> above(layers.begin() + split + 1, layers.end());
+  PlaceTrackerEnvelope(envelope_lv, below, envelope_rmin, inner(above.front()), depth + 1, region);
+  PlaceTrackerEnvelope(envelope_lv, above, outer(below.back()), envelope_rmax, depth + 1, region);
 }
 
 /*****************************************************************/
@@ -250,13 +525,8 @@ DetectorConstruction::ConstructSDandField()
     G4SDManager::GetSDMpointer()->AddNewDetector(tracker_sd);
     SetSensitiveDetector("layer_lv", tracker_sd, true);
   }
-    
-  G4ThreeVector fieldValue = G4ThreeVector();
-  auto MagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
-  MagFieldMessenger->SetVerboseLevel(1);
-  
-  // Register the field messenger for deleting
-  G4AutoDelete::Register(MagFieldMessenger);
+
+  FieldSetup::Instance()->Construct();
 }
 
 /*****************************************************************/
@@ -12,10 +12,16 @@
 class G4String;
 class G4Material;
 class G4OpticalSurface;
+class G4Region;
+class G4UserLimits;
+class G4LogicalVolume;
 
 class G4UIcommand;
 class G4UIdirectory;
 class G4UIcmdWithADoubleAndUnit;
+class G4UIcmdWithABool;
+class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
 
 namespace G4me {
 
@@ -31,9 +37,20 @@ public:
   G4VPhysicalVolume *Construct() override;
   void ConstructSDandField() override;
 
+  const std::vector<std::map<std::string, double>> &GetTrackerLayers() const { return mTrackerLayer; };
+
 protected:
 
   void SetNewValue(G4UIcommand *command, G4String value);
+
+  G4Region *GetRegion(const std::string &name) const;
+  void ApplyRegionCuts(const std::string &name);
+  void ApplyRegionLimits(const std::string &name);
+  void RegisterStepLimiter();
+
+  void PlaceTrackerLayer(G4LogicalVolume *mother, int index, G4Region *region);
+  void PlaceTrackerEnvelope(G4LogicalVolume *mother, const std::vector<int> &layers,
+			    double rmin, double rmax, int depth, G4Region *region);
   
   G4UIdirectory *mDetectorDirectory;
 
@@ -47,7 +64,22 @@ protected:
 
   G4UIdirectory *mTrackerDirectory;
   G4UIcommand *mTrackerAddLayerCmd;
+  G4UIcmdWithABool *mTrackerEnvelopesCmd;
+  G4UIcmdWithAString *mTrackerEnvelopeMaterialCmd;
+  G4UIcmdWithAnInteger *mTrackerEnvelopeLayersCmd;
   std::vector<std::map<std::string, double>> mTrackerLayer;
+  bool mTrackerEnvelopes;
+  std::string mTrackerEnvelopeMaterial;
+  int mTrackerEnvelopeLayers;
+  int mTrackerEnvelopeCopy;
+
+  G4UIdirectory *mRegionsDirectory;
+  G4UIcommand *mRegionsSetCutCmd;
+  G4UIcommand *mRegionsSetLimitCmd;
+  std::map<std::string, std::map<std::string, double>> mRegionCuts;
+  std::map<std::string, std::map<std::string, double>> mRegionLimits;
+  std::map<std::string, G4UserLimits *> mRegionUserLimits;
+  bool mStepLimiter = false;
 };
 
 } /** namespace G4me **/
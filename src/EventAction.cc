@@ -5,6 +5,7 @@
 #include "G4Event.hh"
 
 #include "RootIO.hh"
+#include "EventStats.hh"
 
 namespace G4me {
 
@@ -14,6 +15,7 @@ void
 EventAction::BeginOfEventAction(const G4Event *aEvent)
 {
   RootIO::Instance()->BeginOfEventAction(aEvent);
+  EventStats::Instance()->Start(EventStats::kTransport);
 }
 
 /******************************************************************************/
@@ -21,6 +23,7 @@ EventAction::BeginOfEventAction(const G4Event *aEvent)
 void
 EventAction::EndOfEventAction(const G4Event *aEvent)
 {
+  EventStats::Instance()->Stop(EventStats::kTransport);
   RootIO::Instance()->EndOfEventAction(aEvent);
 }
 
@@ -0,0 +1,111 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "EventStats.hh"
+#include "G4Run.hh"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <unistd.h>
+
+namespace G4me {
+
+EventStats *EventStats::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+EventStats::BeginOfRunAction(const G4Run *aRun)
+{
+  Reset();
+  mEvents = 0;
+  for (int i = 0; i < kNPhases; ++i) mSumTime[i] = mSumTime2[i] = 0.;
+  mSumTracks = mSumHits = 0.;
+  mMaxRSS = 0.;
+}
+
+/*****************************************************************/
+
+void
+EventStats::EndOfRunAction(const G4Run *aRun)
+{
+  if (mEvents == 0) return;
+  const char *names[kNPhases] = {"generation", "decay     ", "transport ", "output    "};
+  std::cout << " --- event statistics: " << mEvents << " events" << std::endl;
+  for (int i = 0; i < kNPhases; ++i) {
+    auto mean = mSumTime[i] / mEvents;
+    auto rms = std::sqrt(std::fabs(mSumTime2[i] / mEvents - mean * mean));
+    std::cout << "     " << names[i] << " = " << mean << " +- " << rms << " ms/event" << std::endl;
+  }
+  std::cout << "     tracks     = " << mSumTracks / mEvents << " /event" << std::endl
+	    << "     hits       = " << mSumHits / mEvents << " /event" << std::endl
+	    << "     RSS        = " << mMaxRSS << " MB (max), " << ReadPeakRSS() << " MB (peak)" << std::endl;
+}
+
+/*****************************************************************/
+
+void
+EventStats::Reset()
+{
+  for (int i = 0; i < kNPhases; ++i) mData.time[i] = 0.;
+  mData.ntracks = mData.nhits = mData.nparticles = 0;
+  mData.rss = 0.;
+}
+
+/*****************************************************************/
+
+void
+EventStats::EndOfEvent(int ntracks, int nhits, int nparticles)
+{
+  /** decays happen during transport **/
+  mData.time[kTransport] -= mData.time[kDecay];
+  mData.ntracks = ntracks;
+  mData.nhits = nhits;
+  mData.nparticles = nparticles;
+  mData.rss = ReadRSS();
+
+  mEvents++;
+  for (int i = 0; i < kNPhases; ++i) {
+    mSumTime[i] += mData.time[i];
+    mSumTime2[i] += mData.time[i] * mData.time[i];
+  }
+  mSumTracks += ntracks;
+  mSumHits += nhits;
+  if (mData.rss > mMaxRSS) mMaxRSS = mData.rss;
+}
+
+/*****************************************************************/
+
+float
+EventStats::ReadRSS()
+{
+  long pages = 0;
+  auto fin = std::fopen("/proc/self/statm", "r");
+  if (!fin) return 0.;
+  if (std::fscanf(fin, "%*s %ld", &pages) != 1) pages = 0;
+  std::fclose(fin);
+  return pages * (sysconf(_SC_PAGESIZE) / 1048576.);
+}
+
+/*****************************************************************/
+
+float
+EventStats::ReadPeakRSS()
+{
+  long kb = 0;
+  char line[256];
+  auto fin = std::fopen("/proc/self/status", "r");
+  if (!fin) return 0.;
+  while (std::fgets(line, sizeof(line), fin))
+    if (std::strncmp(line, "VmHWM:", 6) == 0) {
+      std::sscanf(line + 6, "%ld", &kb);
+      break;
+    }
+  std::fclose(fin);
+  return kb / 1024.;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,79 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _EventStats_h_
+#define _EventStats_h_
+
+#include <chrono>
+
+class G4Run;
+
+namespace G4me {
+
+/** per-event timing of the simulation phases
+    and resource usage, written to the EventStats tree **/
+  
+class EventStats
+{
+  
+public:
+
+  static EventStats *Instance() {
+    if (!mInstance) mInstance = new EventStats();
+    return mInstance;
+  };
+
+  enum EPhase_t {
+    kGeneration,
+    kDecay,
+    kTransport,
+    kOutput,
+    kNPhases
+  };
+
+  struct EventStats_t {
+    float  time[kNPhases]; // ms
+    int    ntracks;
+    int    nhits;
+    int    nparticles;
+    float  rss; // MB
+  };
+
+  void BeginOfRunAction(const G4Run *aRun);
+  void EndOfRunAction(const G4Run *aRun);
+  
+  void Start(EPhase_t phase) { mStart[phase] = std::chrono::steady_clock::now(); };
+  void Stop(EPhase_t phase) {
+    mData.time[phase] += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mStart[phase]).count();
+  };
+  
+  void EndOfEvent(int ntracks, int nhits, int nparticles);
+  void Reset();
+
+  EventStats_t &GetData() { return mData; };
+
+  static float ReadRSS();
+  static float ReadPeakRSS();
+  
+private:
+
+  EventStats() { Reset(); };
+
+  static EventStats *mInstance;
+
+  EventStats_t mData;
+  std::chrono::steady_clock::time_point mStart[kNPhases];
+
+  /** run summary **/
+  long mEvents = 0;
+  double mSumTime[kNPhases];
+  double mSumTime2[kNPhases];
+  double mSumTracks = 0.;
+  double mSumHits = 0.;
+  float mMaxRSS = 0.;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _EventStats_h_ **/
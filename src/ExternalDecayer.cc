@@ -4,12 +4,24 @@
 #include "ExternalDecayer.hh"
 #include "Pythia8.hh"
 #include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4DecayProducts.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 #include "G4ParticleTable.hh"
+#include "EventStats.hh"
 
 namespace G4me {
 
+ExternalDecayer *ExternalDecayer::mInstance = nullptr;
+
+/*****************************************************************/
+
+ExternalDecayer::ExternalDecayer()
+{
+  mDisplacements.reserve(16);
+}
+
 /*****************************************************************/
 
 void
@@ -18,9 +30,44 @@ ExternalDecayer::SetNewValue(G4UIcommand *command, G4String value)
   
 /*****************************************************************/
 
+void
+ExternalDecayer::BuildParticleTable()
+{
+  mParticleTable.clear();
+  auto particleTable = G4ParticleTable::GetParticleTable();
+  auto particleIterator = particleTable->GetIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    auto particle = particleIterator->value();
+    auto pdg = particle->GetPDGEncoding();
+    if (pdg == 0) continue;
+    mParticleTable[pdg] = particle;
+  }
+  std::cout << " --- external decayer particle table: " << mParticleTable.size() << " entries" << std::endl;
+}
+
+/*****************************************************************/
+
+G4ParticleDefinition *
+ExternalDecayer::FindParticle(int pdg)
+{
+  auto it = mParticleTable.find(pdg);
+  if (it != mParticleTable.end()) return it->second;
+
+  /** not in the table (i.e. ions created on the fly), look it up and cache it **/
+  auto particle = G4ParticleTable::GetParticleTable()->FindParticle(pdg);
+  if (particle) mParticleTable[pdg] = particle;
+  return particle;
+}
+
+/*****************************************************************/
+
 G4DecayProducts *
 ExternalDecayer::ImportDecayProducts(const G4Track &aTrack)
 {
+  mDisplacements.clear();
+  EventStats::Instance()->Start(EventStats::kDecay);
+  
   auto pdg = aTrack.GetDefinition()->GetPDGEncoding();
   auto px = aTrack.GetMomentum().x() / GeV;
   auto py = aTrack.GetMomentum().y() / GeV;
@@ -43,31 +90,58 @@ ExternalDecayer::ImportDecayProducts(const G4Track &aTrack)
   decayProducts->SetParentParticle(*aTrack.GetDynamicParticle());
   auto nParticles = pythia->event.size();
   for (int iparticle = 0; iparticle < nParticles; iparticle++) {
-    auto aParticle = pythia->event[iparticle];
+    const auto &aParticle = pythia->event[iparticle];
     if (aParticle.statusHepMC() != 1) continue;
 
     auto pdg = aParticle.id();
-    auto px = aParticle.px() * GeV;
-    auto py = aParticle.py() * GeV;
-    auto pz = aParticle.pz() * GeV;
-    auto et = aParticle.e() * GeV;
-    auto vx = aParticle.xProd() * mm;
-    auto vy = aParticle.yProd() * mm;
-    auto vz = aParticle.zProd() * mm;
-    auto vt = aParticle.tProd() * mm / c_light;
-
-    // [WARNING]: position and time is not set
-    auto dynamicParticle = new G4DynamicParticle(G4ParticleTable::GetParticleTable()->FindParticle(pdg),
-						 G4ThreeVector(px, py, pz));
-
+    auto particle = FindParticle(pdg);
+    if (!particle) {
+      std::cout << " --- external decayer: unknown particle " << pdg << ", skipped" << std::endl;
+      continue;
+    }
+    
+    /** G4DynamicParticle is allocated from the Geant4 pool allocator **/
+    auto dynamicParticle = new G4DynamicParticle(particle,
+						 G4ThreeVector(aParticle.px() * GeV,
+							       aParticle.py() * GeV,
+							       aParticle.pz() * GeV));
     decayProducts->PushProducts(dynamicParticle);
-  }
-  
 
+    /** the parent decays at the origin of the Pythia8 event,
+	products of intermediate decays are displaced from it **/
+    if (aParticle.xProd() == 0. && aParticle.yProd() == 0. &&
+	aParticle.zProd() == 0. && aParticle.tProd() == 0.) continue;
+    mDisplacements.push_back({dynamicParticle, G4LorentzVector(aParticle.xProd() * mm,
+							       aParticle.yProd() * mm,
+							       aParticle.zProd() * mm,
+							       aParticle.tProd() * mm / c_light)});
+  }
   
+  EventStats::Instance()->Stop(EventStats::kDecay);
   return decayProducts;
 }
 
 /*****************************************************************/
 
+void
+ExternalDecayer::ApplyDisplacements(G4TrackVector *secondaries)
+{
+  if (mDisplacements.empty()) return;
+
+  /** G4Decay places all products at the decay point of the parent,
+      here we move the displaced ones to their production vertex **/
+  for (auto secondary : *secondaries) {
+    auto dynamicParticle = secondary->GetDynamicParticle();
+    for (const auto &displacement : mDisplacements) {
+      if (displacement.first != dynamicParticle) continue;
+      secondary->SetPosition(secondary->GetPosition() + displacement.second.vect());
+      secondary->SetGlobalTime(secondary->GetGlobalTime() + displacement.second.t());
+      break;
+    }
+  }
+  mDisplacements.clear();
+}
+
+/*****************************************************************/
+
 } /** namespace G4me **/
@@ -6,6 +6,13 @@
 
 #include "G4VExtDecayer.hh"
 #include "G4UImessenger.hh"
+#include "G4TrackVector.hh"
+#include "G4LorentzVector.hh"
+#include <unordered_map>
+#include <vector>
+
+class G4ParticleDefinition;
+class G4DynamicParticle;
 
 namespace G4me {
 
@@ -15,14 +22,31 @@ class ExternalDecayer : public G4VExtDecayer,
   
 public:
   
-  ExternalDecayer() = default;
-  ~ExternalDecayer() = default;
+  static ExternalDecayer *Instance() {
+    if (!mInstance) mInstance = new ExternalDecayer();
+    return mInstance;
+  };
 
   G4DecayProducts *ImportDecayProducts(const G4Track &aTrack);
+
+  /** PDG to particle definition lookup table, built once **/
+  void BuildParticleTable();
+  G4ParticleDefinition *FindParticle(int pdg);
+
+  /** move the products of the last decay to their displaced vertices **/
+  void ApplyDisplacements(G4TrackVector *secondaries);
   
 protected:
 
+  ExternalDecayer();
+  ~ExternalDecayer() = default;
+
   void SetNewValue(G4UIcommand *command, G4String value);
+
+  static ExternalDecayer *mInstance;
+
+  std::unordered_map<int, G4ParticleDefinition *> mParticleTable;
+  std::vector<std::pair<const G4DynamicParticle *, G4LorentzVector>> mDisplacements;
   
 };
 
@@ -22,8 +22,9 @@ ExternalDecayerPhysics::ConstructProcess()
 {
   std::cout << " --- constructing external decayer physics" << std::endl;
 
-  /** create external decayer **/
-  auto externalDecayer = new ExternalDecayer();
+  /** create external decayer and its PDG lookup table **/
+  auto externalDecayer = ExternalDecayer::Instance();
+  externalDecayer->BuildParticleTable();
   
   auto particleIterator = GetParticleIterator();
   particleIterator->reset();
@@ -0,0 +1,243 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "FieldMap.hh"
+#include "G4SystemOfUnits.hh"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+
+/** text format, lengths in cm and field in tesla:
+
+    # comment
+    cartesian   nx ny nz  xmin xmax  ymin ymax  zmin zmax
+    cylindrical nr nz  rmin rmax  zmin zmax
+    Bx By Bz | Br Bz       one node per line, last index fastest
+
+    binary format, Geant4 units:
+
+    char[8] "G4MEFMAP", int32 geometry, int32 n[3], double min[3], double max[3]
+    float field[n[0] * n[1] * n[2] * components] **/
+
+namespace G4me {
+
+static const char kMagic[8] = {'G', '4', 'M', 'E', 'F', 'M', 'A', 'P'};
+
+/*****************************************************************/
+
+bool
+FieldMap::Load(const std::string &filename, double scale)
+{
+  std::ifstream fin(filename, std::ios::binary);
+  if (!fin.is_open()) {
+    std::cout << " --- field map: cannot open " << filename << std::endl;
+    return false;
+  }
+  char magic[8] = {0};
+  fin.read(magic, 8);
+  bool binary = fin.gcount() == 8 && std::memcmp(magic, kMagic, 8) == 0;
+  if (!binary) fin.seekg(0);
+  if (!(binary ? LoadBinary(fin) : LoadText(fin))) {
+    std::cout << " --- field map: bad format in " << filename << std::endl;
+    return false;
+  }
+
+  /** nodes are contiguous along the last dimension **/
+  mDim = mGeometry == kCylindrical ? 2 : 3;
+  mComponents = mGeometry == kCylindrical ? 2 : 3;
+  mStride[mDim - 1] = mComponents;
+  for (int d = mDim - 2; d >= 0; --d) mStride[d] = mStride[d + 1] * mN[d + 1];
+  for (int d = 0; d < mDim; ++d) mInvStep[d] = (mN[d] - 1) / (mMax[d] - mMin[d]);
+  for (auto &value : mField) value *= scale;
+  mCell[0] = mCell[1] = mCell[2] = -1;
+
+  std::cout << " --- field map: loaded " << filename << (binary ? " (binary)" : " (text)") << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+FieldMap::LoadText(std::istream &in)
+{
+  std::string line, geometry;
+  while (std::getline(in, line))
+    if (!line.empty() && line[0] != '#') break;
+  std::istringstream iss(line);
+  iss >> geometry;
+  if (geometry.compare("cartesian") == 0) {
+    mGeometry = kCartesian;
+    iss >> mN[0] >> mN[1] >> mN[2] >> mMin[0] >> mMax[0] >> mMin[1] >> mMax[1] >> mMin[2] >> mMax[2];
+  }
+  else if (geometry.compare("cylindrical") == 0) {
+    mGeometry = kCylindrical;
+    mN[2] = 1;
+    iss >> mN[0] >> mN[1] >> mMin[0] >> mMax[0] >> mMin[1] >> mMax[1];
+  }
+  else return false;
+  if (iss.fail() || !CheckGrid()) return false;
+  for (int d = 0; d < 3; ++d) {
+    mMin[d] *= cm;
+    mMax[d] *= cm;
+  }
+
+  auto size = (size_t)mN[0] * mN[1] * mN[2] * (mGeometry == kCylindrical ? 2 : 3);
+  mField.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    double value;
+    while (in.peek() == '#') std::getline(in, line);
+    if (!(in >> value)) return false;
+    mField[i] = value * tesla;
+  }
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+FieldMap::LoadBinary(std::istream &in)
+{
+  int32_t geometry, n[3];
+  in.read((char *)&geometry, sizeof(geometry));
+  in.read((char *)n, sizeof(n));
+  in.read((char *)mMin, sizeof(mMin));
+  in.read((char *)mMax, sizeof(mMax));
+  if (!in || (geometry != kCartesian && geometry != kCylindrical)) return false;
+  mGeometry = (EGeometry_t)geometry;
+  for (int d = 0; d < 3; ++d) mN[d] = n[d];
+  if (!CheckGrid()) return false;
+  auto size = (size_t)mN[0] * mN[1] * mN[2] * (mGeometry == kCylindrical ? 2 : 3);
+  mField.resize(size);
+  in.read((char *)mField.data(), size * sizeof(float));
+  return (bool)in;
+}
+
+/*****************************************************************/
+
+bool
+FieldMap::CheckGrid() const
+{
+  /** at least two nodes and a positive range in the dimensions of the map,
+      a single node in the unused one **/
+  auto dim = mGeometry == kCylindrical ? 2 : 3;
+  for (int d = 0; d < 3; ++d) {
+    if (d >= dim && mN[d] != 1) return false;
+    if (d < dim && (mN[d] < 2 || !(mMax[d] > mMin[d]))) return false;
+  }
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+FieldMap::WriteBinary(const std::string &filename) const
+{
+  std::ofstream fout(filename, std::ios::binary);
+  if (!fout.is_open()) return false;
+  int32_t geometry = mGeometry, n[3] = {mN[0], mN[1], mN[2]};
+  fout.write(kMagic, 8);
+  fout.write((const char *)&geometry, sizeof(geometry));
+  fout.write((const char *)n, sizeof(n));
+  fout.write((const char *)mMin, sizeof(mMin));
+  fout.write((const char *)mMax, sizeof(mMax));
+  fout.write((const char *)mField.data(), mField.size() * sizeof(float));
+  return (bool)fout;
+}
+
+/*****************************************************************/
+
+void
+FieldMap::Print() const
+{
+  const char *axis[2][3] = {{"x", "y", "z"}, {"r", "z", ""}};
+  std::cout << " --- field map: " << (mGeometry == kCylindrical ? "cylindrical" : "cartesian");
+  for (int d = 0; d < mDim; ++d)
+    std::cout << ", " << axis[mGeometry][d] << " = [" << mMin[d] / cm << ", " << mMax[d] / cm << "] cm (" << mN[d] << " nodes)";
+  std::cout << std::endl;
+}
+
+/*****************************************************************/
+
+bool
+FieldMap::Locate(const double *x) const
+{
+  /** same cell as the previous query **/
+  bool same = mCell[0] >= 0;
+  for (int d = 0; d < mDim && same; ++d)
+    same = x[d] >= mCellMin[d] && x[d] < mCellMax[d];
+
+  if (!same) {
+    mCellOffset = 0;
+    for (int d = 0; d < mDim; ++d) {
+      if (x[d] < mMin[d] || x[d] > mMax[d]) return false;
+      int i = (x[d] - mMin[d]) * mInvStep[d];
+      if (i > mN[d] - 2) i = mN[d] - 2;
+      mCell[d] = i;
+      mCellMin[d] = mMin[d] + i / mInvStep[d];
+      mCellMax[d] = mMin[d] + (i + 1) / mInvStep[d];
+      mCellOffset += i * mStride[d];
+    }
+  }
+
+  for (int d = 0; d < mDim; ++d)
+    mFrac[d] = (x[d] - mCellMin[d]) * mInvStep[d];
+  return true;
+}
+
+/*****************************************************************/
+
+void
+FieldMap::GetFieldValue(const G4double point[4], G4double *field) const
+{
+  field[0] = field[1] = field[2] = 0.;
+
+  if (mGeometry == kCylindrical) {
+    double x[2] = {std::sqrt(point[0] * point[0] + point[1] * point[1]), point[2]};
+    if (!Locate(x)) return;
+
+    /** bilinear in (r, z), fixed-size loops over the corners **/
+    const float *v = mField.data() + mCellOffset;
+    const int corner[4] = {0, mStride[1], mStride[0], mStride[0] + mStride[1]};
+    const double u = mFrac[0], w = mFrac[1];
+    const double weight[4] = {(1. - u) * (1. - w), (1. - u) * w, u * (1. - w), u * w};
+    double b[2] = {0., 0.};
+    for (int k = 0; k < 4; ++k) {
+      b[0] += weight[k] * v[corner[k]];
+      b[1] += weight[k] * v[corner[k] + 1];
+    }
+    if (x[0] > 0.) {
+      field[0] = b[0] * point[0] / x[0];
+      field[1] = b[0] * point[1] / x[0];
+    }
+    field[2] = b[1];
+    return;
+  }
+
+  if (!Locate(point)) return;
+
+  /** trilinear, fixed-size loops over the corners **/
+  const float *v = mField.data() + mCellOffset;
+  const int corner[8] = {0, mStride[2], mStride[1], mStride[1] + mStride[2],
+			 mStride[0], mStride[0] + mStride[2], mStride[0] + mStride[1], mStride[0] + mStride[1] + mStride[2]};
+  const double u = mFrac[0], s = mFrac[1], w = mFrac[2];
+  const double weight[8] = {(1. - u) * (1. - s) * (1. - w), (1. - u) * (1. - s) * w,
+			    (1. - u) * s * (1. - w),        (1. - u) * s * w,
+			    u * (1. - s) * (1. - w),        u * (1. - s) * w,
+			    u * s * (1. - w),               u * s * w};
+  double b[3] = {0., 0., 0.};
+  for (int k = 0; k < 8; ++k) {
+    b[0] += weight[k] * v[corner[k]];
+    b[1] += weight[k] * v[corner[k] + 1];
+    b[2] += weight[k] * v[corner[k] + 2];
+  }
+  field[0] = b[0];
+  field[1] = b[1];
+  field[2] = b[2];
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,67 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _FieldMap_h_
+#define _FieldMap_h_
+
+#include "G4MagneticField.hh"
+#include <vector>
+#include <string>
+
+namespace G4me {
+
+/** magnetic field map on a regular grid, cylindrical (r, z)
+    with Br, Bz or Cartesian (x, y, z) with Bx, By, Bz.
+    the components of one node are contiguous in memory and
+    the last cell is cached for consecutive queries along a track **/
+
+class FieldMap final : public G4MagneticField
+{
+
+public:
+
+  enum EGeometry_t {
+    kCartesian,
+    kCylindrical
+  };
+
+  FieldMap() = default;
+  ~FieldMap() override = default;
+
+  bool Load(const std::string &filename, double scale = 1.);
+  bool WriteBinary(const std::string &filename) const;
+  void Print() const;
+
+  void GetFieldValue(const G4double point[4], G4double *field) const override;
+
+  G4Field *Clone() const override { return new FieldMap(*this); };
+
+private:
+
+  bool LoadText(std::istream &in);
+  bool LoadBinary(std::istream &in);
+  bool CheckGrid() const;
+  bool Locate(const double *x) const;
+
+  EGeometry_t mGeometry = kCartesian;
+  int mDim = 3;                  // grid dimensions, 2 for cylindrical
+  int mComponents = 3;           // field components per node
+  int mN[3] = {1, 1, 1};         // nodes per dimension
+  double mMin[3] = {0., 0., 0.}; // grid range in Geant4 units
+  double mMax[3] = {0., 0., 0.};
+  double mInvStep[3] = {0., 0., 0.};
+  int mStride[3] = {0, 0, 0};    // node stride per dimension, in floats
+  std::vector<float> mField;     // in Geant4 units
+
+  /** last cell, per instance: each thread owns its own clone **/
+  mutable int mCell[3] = {-1, -1, -1};
+  mutable int mCellOffset = 0;
+  mutable double mCellMin[3];
+  mutable double mCellMax[3];
+  mutable double mFrac[3];
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _FieldMap_h_ **/
@@ -0,0 +1,318 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "FieldSetup.hh"
+#include "SolenoidField.hh"
+#include "FieldMap.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4StateManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4FieldManager.hh"
+#include "G4Field.hh"
+#include "G4ChordFinder.hh"
+#include "G4Mag_UsualEqRhs.hh"
+#include "G4ExactHelixStepper.hh"
+#include "G4HelixExplicitEuler.hh"
+#include "G4ClassicalRK4.hh"
+#include "G4CashKarpRKF45.hh"
+#include "G4BogackiShampine45.hh"
+#include "G4DormandPrince745.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4LogicalVolume.hh"
+
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcmdWith3VectorAndUnit.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "G4UIcmdWithAString.hh"
+
+namespace G4me {
+
+FieldSetup *FieldSetup::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+FieldSetup::InitMessenger()
+{
+  mFieldDirectory = new G4UIdirectory("/detector/field/");
+
+  mStepperCmd = new G4UIcommand("/detector/field/stepper", this);
+  mStepperCmd->SetGuidance("Select the integration stepper, globally or in a region.");
+  mStepperCmd->SetGuidance("  helix : exact helix, only valid for a uniform field");
+  mStepperCmd->SetGuidance("  dormandprince : Geant4 default");
+  auto parameter = new G4UIparameter("stepper", 's', false);
+  parameter->SetParameterCandidates("helix helixeuler classical cashkarp bogackishampine dormandprince");
+  mStepperCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("region", 's', true);
+  parameter->SetDefaultValue("world");
+  parameter->SetParameterCandidates("world pipe tracker");
+  mStepperCmd->SetParameter(parameter);
+  mStepperCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mDeltaChordCmd = new G4UIcommand("/detector/field/deltaChord", this);
+  mDeltaChordCmd->SetGuidance("Maximum miss distance between chord and trajectory, globally or in a region.");
+  mDeltaIntersectionCmd = new G4UIcommand("/detector/field/deltaIntersection", this);
+  mDeltaIntersectionCmd->SetGuidance("Accuracy of the boundary intersection, globally or in a region.");
+  for (auto cmd : {mDeltaChordCmd, mDeltaIntersectionCmd}) {
+    cmd->SetParameter(new G4UIparameter("value", 'd', false));
+    cmd->SetParameter(new G4UIparameter("unit", 's', false));
+    parameter = new G4UIparameter("region", 's', true);
+    parameter->SetDefaultValue("world");
+    parameter->SetParameterCandidates("world pipe tracker");
+    cmd->SetParameter(parameter);
+    cmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+  }
+
+  mMinEpsilonCmd = new G4UIcommand("/detector/field/minEpsilon", this);
+  mMinEpsilonCmd->SetGuidance("Minimum relative accuracy of one integration step, globally or in a region.");
+  mMaxEpsilonCmd = new G4UIcommand("/detector/field/maxEpsilon", this);
+  mMaxEpsilonCmd->SetGuidance("Maximum relative accuracy of one integration step, globally or in a region.");
+  for (auto cmd : {mMinEpsilonCmd, mMaxEpsilonCmd}) {
+    cmd->SetParameter(new G4UIparameter("value", 'd', false));
+    parameter = new G4UIparameter("region", 's', true);
+    parameter->SetDefaultValue("world");
+    parameter->SetParameterCandidates("world pipe tracker");
+    cmd->SetParameter(parameter);
+    cmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+  }
+
+  mMapCmd = new G4UIcommand("/detector/field/map", this);
+  mMapCmd->SetGuidance("Use a field map instead of the uniform field, none to go back.");
+  mMapCmd->SetGuidance("Text (cm, tesla) or binary grid, cylindrical r-z or cartesian.");
+  mMapCmd->SetParameter(new G4UIparameter("filename", 's', false));
+  parameter = new G4UIparameter("scale", 'd', true);
+  parameter->SetDefaultValue(1.);
+  mMapCmd->SetParameter(parameter);
+  mMapCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mSaveMapCmd = new G4UIcmdWithAString("/detector/field/saveMap", this);
+  mSaveMapCmd->SetGuidance("Write the field map in binary format, faster to load.");
+  mSaveMapCmd->SetParameterName("filename", false);
+  mSaveMapCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mPrintCmd = new G4UIcmdWithoutParameter("/detector/field/print", this);
+  mPrintCmd->SetGuidance("Print the field and propagation settings");
+  mPrintCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  /** same commands as G4GlobalMagFieldMessenger **/
+
+  mGlobalFieldDirectory = new G4UIdirectory("/globalField/");
+  mGlobalFieldDirectory->SetGuidance("Global uniform magnetic field UI commands");
+
+  mGlobalFieldSetValueCmd = new G4UIcmdWith3VectorAndUnit("/globalField/setValue", this);
+  mGlobalFieldSetValueCmd->SetGuidance("Set uniform magnetic field value.");
+  mGlobalFieldSetValueCmd->SetParameterName("Bx", "By", "Bz", false);
+  mGlobalFieldSetValueCmd->SetUnitCategory("Magnetic flux density");
+  mGlobalFieldSetValueCmd->SetDefaultUnit("tesla");
+  mGlobalFieldSetValueCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mGlobalFieldVerboseCmd = new G4UIcmdWithAnInteger("/globalField/verbose", this);
+  mGlobalFieldVerboseCmd->SetGuidance("Set verbose level.");
+  mGlobalFieldVerboseCmd->SetParameterName("verbose", false);
+  mGlobalFieldVerboseCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+FieldSetup::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mGlobalFieldVerboseCmd)
+    mVerbose = mGlobalFieldVerboseCmd->GetNewIntValue(value);
+  if (command == mGlobalFieldSetValueCmd) {
+    mFieldValue = mGlobalFieldSetValueCmd->GetNew3VectorValue(value);
+    if (mVerbose > 0)
+      std::cout << " --- magnetic field set to " << mFieldValue / tesla << " T" << std::endl;
+  }
+  if (command == mStepperCmd) {
+    G4String stepper, region;
+    std::istringstream iss(value);
+    iss >> stepper >> region;
+    mSteppers[region] = stepper;
+  }
+  if (command == mDeltaChordCmd || command == mDeltaIntersectionCmd) {
+    G4String value_value, value_unit, region;
+    std::istringstream iss(value);
+    iss >> value_value >> value_unit >> region;
+    auto name = command == mDeltaChordCmd ? "deltaChord" : "deltaIntersection";
+    mParameters[region][name] = command->ConvertToDimensionedDouble(G4String(value_value + ' ' + value_unit));
+  }
+  if (command == mMinEpsilonCmd || command == mMaxEpsilonCmd) {
+    G4String value_value, region;
+    std::istringstream iss(value);
+    iss >> value_value >> region;
+    auto name = command == mMinEpsilonCmd ? "minEpsilon" : "maxEpsilon";
+    mParameters[region][name] = command->ConvertToDouble(value_value);
+  }
+  if (command == mMapCmd) {
+    G4String filename;
+    double scale = 1.;
+    std::istringstream iss(value);
+    iss >> filename >> scale;
+    if (filename.compare("none") == 0) mFieldMap = nullptr;
+    else {
+      auto fieldMap = new FieldMap();
+      if (!fieldMap->Load(filename, scale)) {
+	delete fieldMap;
+	return;
+      }
+      mFieldMap = fieldMap; // the previous map may still be used by a field manager
+    }
+  }
+  if (command == mSaveMapCmd) {
+    if (!mFieldMap || !mFieldMap->WriteBinary(value))
+      std::cout << " --- field setup: cannot write field map to " << value << std::endl;
+    return;
+  }
+  if (command == mPrintCmd) {
+    Print();
+    return;
+  }
+
+  /** rebuild the propagation when changed after initialisation **/
+  if (mConstructed && G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle)
+    Construct();
+}
+
+/*****************************************************************/
+
+void
+FieldSetup::Construct()
+{
+  mConstructed = true;
+
+  /** without field the region field managers get no field **/
+  if (!mFieldMap && mFieldValue.mag2() == 0.) {
+    G4TransportationManager::GetTransportationManager()->GetFieldManager()->SetDetectorField(nullptr);
+    for (auto &propagator : mPropagators) {
+      if (propagator.first.compare("world") == 0) continue;
+      propagator.second.manager->SetDetectorField(nullptr);
+    }
+    return;
+  }
+
+  if (mFieldMap) mField = mFieldMap;
+  else {
+    if (!mSolenoid) mSolenoid = new SolenoidField();
+    mSolenoid->SetFieldValue(mFieldValue);
+    mField = mSolenoid;
+  }
+
+  ConstructPropagator("world");
+  for (const auto &stepper : mSteppers)
+    if (stepper.first.compare("world") != 0) ConstructPropagator(stepper.first);
+  for (const auto &parameters : mParameters)
+    if (parameters.first.compare("world") != 0) ConstructPropagator(parameters.first);
+
+  if (mVerbose > 0) Print();
+}
+
+/*****************************************************************/
+
+void
+FieldSetup::ConstructPropagator(const std::string &name)
+{
+  auto &propagator = mPropagators[name];
+  auto previous = propagator;
+
+  /** region settings default to those of the world **/
+  auto stepper = mSteppers.count(name) ? mSteppers[name] : mSteppers.count("world") ? mSteppers["world"] : "dormandprince";
+  auto parameters = mParameters["world"];
+  for (const auto &parameter : mParameters[name]) parameters[parameter.first] = parameter.second;
+
+  if (name.compare("world") == 0)
+    propagator.manager = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+  else if (!propagator.manager) {
+    auto region = G4RegionStore::GetInstance()->GetRegion(name, false);
+    if (!region) {
+      std::cout << " --- field setup: region not found: " << name << std::endl;
+      mPropagators.erase(name);
+      return;
+    }
+    propagator.manager = new G4FieldManager();
+    auto lv = region->GetRootLogicalVolumeIterator();
+    for (size_t i = 0; i < region->GetNumberOfRootVolumes(); ++i, ++lv)
+      (*lv)->SetFieldManager(propagator.manager, true);
+  }
+
+  /** the helix steppers assume a uniform field **/
+  if (mFieldMap && stepper.compare(0, 5, "helix") == 0) {
+    std::cout << " --- field setup: " << stepper << " stepper not valid with a field map, using dormandprince" << std::endl;
+    stepper = "dormandprince";
+  }
+
+  propagator.equation = new G4Mag_UsualEqRhs(mField);
+  propagator.stepper = CreateStepper(stepper, propagator.equation);
+  propagator.chordFinder = new G4ChordFinder(mField, 1.e-2 * mm, propagator.stepper);
+  if (parameters.count("deltaChord"))
+    propagator.chordFinder->SetDeltaChord(parameters["deltaChord"]);
+
+  auto manager = propagator.manager;
+  manager->SetDetectorField(mField);
+  manager->SetChordFinder(propagator.chordFinder);
+  if (parameters.count("deltaIntersection"))
+    manager->SetDeltaIntersection(parameters["deltaIntersection"]);
+  if (parameters.count("maxEpsilon"))
+    manager->SetMaximumEpsilonStep(parameters["maxEpsilon"]);
+  if (parameters.count("minEpsilon"))
+    manager->SetMinimumEpsilonStep(parameters["minEpsilon"]);
+
+  /** the chord finder owns the driver but not the stepper **/
+  delete previous.chordFinder;
+  delete previous.stepper;
+  delete previous.equation;
+}
+
+/*****************************************************************/
+
+G4MagIntegratorStepper *
+FieldSetup::CreateStepper(const std::string &name, G4Mag_UsualEqRhs *equation) const
+{
+  if (name.compare("helix") == 0) return new G4ExactHelixStepper(equation);
+  if (name.compare("helixeuler") == 0) return new G4HelixExplicitEuler(equation);
+  if (name.compare("classical") == 0) return new G4ClassicalRK4(equation);
+  if (name.compare("cashkarp") == 0) return new G4CashKarpRKF45(equation);
+  if (name.compare("bogackishampine") == 0) return new G4BogackiShampine45(equation);
+  return new G4DormandPrince745(equation);
+}
+
+/*****************************************************************/
+
+void
+FieldSetup::Print() const
+{
+  if (mFieldMap) mFieldMap->Print();
+  else std::cout << " --- magnetic field: " << mFieldValue / tesla << " T" << std::endl;
+  for (const auto &propagator : mPropagators) {
+    auto manager = propagator.second.manager;
+    if (!manager || !propagator.second.chordFinder) continue;
+    std::cout << "     " << propagator.first
+	      << ": stepper = " << (mSteppers.count(propagator.first) ? mSteppers.at(propagator.first) :
+				    mSteppers.count("world") ? mSteppers.at("world") : "dormandprince")
+	      << ", deltaChord = " << propagator.second.chordFinder->GetDeltaChord() / mm << " mm"
+	      << ", deltaIntersection = " << manager->GetDeltaIntersection() / mm << " mm"
+	      << ", minEpsilon = " << manager->GetMinimumEpsilonStep()
+	      << ", maxEpsilon = " << manager->GetMaximumEpsilonStep() << std::endl;
+  }
+}
+
+/*****************************************************************/
+
+double
+FieldSetup::GetBzAtOrigin()
+{
+  /** from the field of the detector, also when it is not set up here **/
+  auto fieldManager = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+  if (!fieldManager || !fieldManager->GetDetectorField()) return 0.;
+  G4double point[4] = {0., 0., 0., 0.};
+  G4double field[6] = {0., 0., 0., 0., 0., 0.};
+  fieldManager->GetDetectorField()->GetFieldValue(point, field);
+  return field[2];
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
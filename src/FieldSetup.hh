@@ -0,0 +1,97 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _FieldSetup_h_
+#define _FieldSetup_h_
+
+#include "G4UImessenger.hh"
+#include "G4ThreeVector.hh"
+#include <map>
+#include <string>
+
+class G4UIcommand;
+class G4UIdirectory;
+class G4UIcmdWith3VectorAndUnit;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithoutParameter;
+class G4UIcmdWithAString;
+class G4FieldManager;
+class G4Mag_UsualEqRhs;
+class G4MagIntegratorStepper;
+class G4ChordFinder;
+class G4MagneticField;
+
+namespace G4me {
+
+class SolenoidField;
+class FieldMap;
+  
+/** magnetic field, uniform or from a map, and its propagation
+    parameters, globally or for the pipe and tracker regions **/
+  
+class FieldSetup : public G4UImessenger
+{
+  
+public:
+
+  static FieldSetup *Instance() {
+    if (!mInstance) mInstance = new FieldSetup();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void Construct();
+  void Print() const;
+  
+  G4ThreeVector GetFieldValue() const { return mFieldValue; };
+  static double GetBzAtOrigin();
+  bool HasFieldMap() const { return mFieldMap != nullptr; };
+  
+private:
+
+  FieldSetup() = default;
+
+  static FieldSetup *mInstance;
+
+  struct Propagator_t {
+    G4FieldManager *manager = nullptr;
+    G4Mag_UsualEqRhs *equation = nullptr;
+    G4MagIntegratorStepper *stepper = nullptr;
+    G4ChordFinder *chordFinder = nullptr;
+  };
+
+  void ConstructPropagator(const std::string &region);
+  G4MagIntegratorStepper *CreateStepper(const std::string &name, G4Mag_UsualEqRhs *equation) const;
+  
+  G4UIdirectory *mFieldDirectory;
+  G4UIcommand *mStepperCmd;
+  G4UIcommand *mDeltaChordCmd;
+  G4UIcommand *mDeltaIntersectionCmd;
+  G4UIcommand *mMinEpsilonCmd;
+  G4UIcommand *mMaxEpsilonCmd;
+  G4UIcommand *mMapCmd;
+  G4UIcmdWithAString *mSaveMapCmd;
+  G4UIcmdWithoutParameter *mPrintCmd;
+
+  /** compatibility with G4GlobalMagFieldMessenger **/
+  G4UIdirectory *mGlobalFieldDirectory;
+  G4UIcmdWith3VectorAndUnit *mGlobalFieldSetValueCmd;
+  G4UIcmdWithAnInteger *mGlobalFieldVerboseCmd;
+  
+  G4ThreeVector mFieldValue;
+  int mVerbose = 0;
+  bool mConstructed = false;
+  G4MagneticField *mField = nullptr;
+  SolenoidField *mSolenoid = nullptr;
+  FieldMap *mFieldMap = nullptr;
+  std::map<std::string, std::string> mSteppers;
+  std::map<std::string, std::map<std::string, double>> mParameters;
+  std::map<std::string, Propagator_t> mPropagators;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _FieldSetup_h_ **/
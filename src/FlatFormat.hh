@@ -0,0 +1,73 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _FlatFormat_h_
+#define _FlatFormat_h_
+
+#include <cstdint>
+
+namespace G4me {
+namespace Flat {
+
+/** flat columnar event file (.g4f), native byte order, uncompressed:
+
+    Header_t
+    Column_t[ncolumns]          directory
+    column data                 each column aligned to kAlign bytes
+
+    every collection (hits, tracks, particles) has an index column
+    "<collection>.index" of nevents + 1 uint64 values: the entries of
+    event i are [index[i], index[i + 1]) in all its columns.
+    the "event" column holds the event numbers, the "events.<column>"
+    columns one value per event. columns are found by name, adding
+    columns to the schema does not change the version **/
+
+const char kMagic[8] = {'G', '4', 'M', 'E', 'F', 'L', 'A', 'T'};
+const uint32_t kVersion = 1;
+const uint64_t kAlign = 64;
+
+enum EType_t : uint32_t {
+  kChar,
+  kInt,
+  kULong64,
+  kFloat,
+  kDouble,
+  kLong64
+};
+
+inline uint64_t Size(uint32_t type) {
+  const uint64_t size[] = {1, 4, 8, 4, 8, 8};
+  return type < 6 ? size[type] : 0;
+};
+
+/** from the ROOT leaf type code of RootIOSchema.hh **/
+inline EType_t Type(char leaf) {
+  switch (leaf) {
+  case 'B': return kChar;
+  case 'I': return kInt;
+  case 'l': return kULong64;
+  case 'F': return kFloat;
+  case 'D': return kDouble;
+  default: return kLong64;
+  }
+};
+
+struct Header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t ncolumns;
+  uint64_t nevents;
+};
+
+struct Column_t {
+  char name[48];     // "<collection>.<column>"
+  uint32_t type;
+  uint32_t reserved;
+  uint64_t offset;   // from the beginning of the file
+  uint64_t count;    // number of values
+};
+
+} /** namespace Flat **/
+} /** namespace G4me **/
+
+#endif /** _FlatFormat_h_ **/
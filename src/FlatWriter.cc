@@ -0,0 +1,154 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "FlatWriter.hh"
+#include <iostream>
+#include <cstring>
+
+namespace G4me {
+
+/*****************************************************************/
+
+bool
+FlatWriter::Open(const std::string &filename)
+{
+  Close();
+  mFilename = filename;
+  mEvents = mBytes = 0;
+  mEvent = AddColumn("event", Flat::kLong64);
+  return mEvent >= 0;
+}
+
+/*****************************************************************/
+
+int
+FlatWriter::AddColumn(const std::string &name, Flat::EType_t type)
+{
+  if (name.size() >= sizeof(Flat::Column_t::name)) {
+    std::cout << " --- flat writer: column name too long: " << name << std::endl;
+    return -1;
+  }
+  auto tmp = mFilename + "." + std::to_string(mColumns.size()) + ".tmp";
+  auto file = std::fopen(tmp.c_str(), "wb+");
+  if (!file) {
+    std::cout << " --- flat writer: cannot create " << tmp << std::endl;
+    return -1;
+  }
+  std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+  mColumns.push_back({name, type, tmp, file, 0});
+  return mColumns.size() - 1;
+}
+
+/*****************************************************************/
+
+int
+FlatWriter::Collection(const std::string &name)
+{
+  auto index = AddColumn(name + ".index", Flat::kULong64);
+  if (index < 0) return -1;
+  mCollections.push_back({name, index, 0});
+  Fill(index, &mCollections.back().entries, 1);
+  return mCollections.size() - 1;
+}
+
+/*****************************************************************/
+
+int
+FlatWriter::Column(int collection, const std::string &name, Flat::EType_t type)
+{
+  return AddColumn(mCollections[collection].name + "." + name, type);
+}
+
+/*****************************************************************/
+
+void
+FlatWriter::Fill(int column, const void *data, uint64_t n)
+{
+  auto &c = mColumns[column];
+  std::fwrite(data, Flat::Size(c.type), n, c.file);
+  c.count += n;
+  mBytes += n * Flat::Size(c.type);
+}
+
+/*****************************************************************/
+
+void
+FlatWriter::Next(int collection, uint64_t n)
+{
+  auto &c = mCollections[collection];
+  c.entries += n;
+  Fill(c.index, &c.entries, 1);
+}
+
+/*****************************************************************/
+
+void
+FlatWriter::EndOfEvent(long long event)
+{
+  int64_t id = event;
+  Fill(mEvent, &id, 1);
+  mEvents++;
+}
+
+/*****************************************************************/
+
+bool
+FlatWriter::Close()
+{
+  if (mColumns.empty()) return true;
+
+  bool ok = true;
+  auto fout = std::fopen(mFilename.c_str(), "wb");
+  if (!fout) {
+    std::cout << " --- flat writer: cannot create " << mFilename << std::endl;
+    ok = false;
+  }
+
+  /** directory first, the offsets are known from the counts **/
+  std::vector<Flat::Column_t> directory(mColumns.size());
+  auto align = [](uint64_t offset) { return (offset + Flat::kAlign - 1) / Flat::kAlign * Flat::kAlign; };
+  uint64_t offset = sizeof(Flat::Header_t) + directory.size() * sizeof(Flat::Column_t);
+  for (int i = 0; i < mColumns.size(); ++i) {
+    std::memset(&directory[i], 0, sizeof(Flat::Column_t));
+    std::strncpy(directory[i].name, mColumns[i].name.c_str(), sizeof(directory[i].name) - 1);
+    directory[i].type = mColumns[i].type;
+    directory[i].offset = offset = align(offset);
+    directory[i].count = mColumns[i].count;
+    offset += mColumns[i].count * Flat::Size(mColumns[i].type);
+  }
+  Flat::Header_t header;
+  std::memcpy(header.magic, Flat::kMagic, sizeof(header.magic));
+  header.version = Flat::kVersion;
+  header.ncolumns = directory.size();
+  header.nevents = mEvents;
+  if (fout) {
+    std::fwrite(&header, sizeof(header), 1, fout);
+    std::fwrite(directory.data(), sizeof(Flat::Column_t), directory.size(), fout);
+  }
+
+  /** then the columns **/
+  std::vector<char> buffer(1 << 20);
+  for (int i = 0; i < mColumns.size(); ++i) {
+    auto file = mColumns[i].file;
+    if (fout) {
+      static const char zero[Flat::kAlign] = {0};
+      std::fwrite(zero, 1, directory[i].offset - std::ftell(fout), fout);
+      std::rewind(file);
+      size_t n;
+      while ((n = std::fread(buffer.data(), 1, buffer.size(), file)) > 0)
+	ok = std::fwrite(buffer.data(), 1, n, fout) == n && ok;
+    }
+    std::fclose(file);
+    std::remove(mColumns[i].tmp.c_str());
+  }
+  if (fout) ok = std::fclose(fout) == 0 && ok;
+
+  mColumns.clear();
+  mCollections.clear();
+  mEvent = -1;
+  return ok;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
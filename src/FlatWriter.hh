@@ -0,0 +1,68 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _FlatWriter_h_
+#define _FlatWriter_h_
+
+#include "FlatFormat.hh"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace G4me {
+
+/** writes the flat columnar format of FlatFormat.hh.
+    during the run each column is appended to its own temporary
+    file, which are concatenated into the output by Close **/
+
+class FlatWriter
+{
+
+public:
+
+  FlatWriter() = default;
+  ~FlatWriter() { Close(); };
+
+  bool Open(const std::string &filename);
+  bool Close();
+
+  int Collection(const std::string &name);
+  int Column(int collection, const std::string &name, Flat::EType_t type);
+  int Column(const std::string &name, Flat::EType_t type) { return AddColumn(name, type); };
+
+  void Fill(int column, const void *data, uint64_t n);
+  void Next(int collection, uint64_t n);
+  void EndOfEvent(long long event);
+
+  uint64_t GetBytes() const { return mBytes; };
+
+private:
+
+  struct Column_t {
+    std::string name;
+    Flat::EType_t type;
+    std::string tmp;
+    FILE *file;
+    uint64_t count;
+  };
+
+  struct Collection_t {
+    std::string name;
+    int index;
+    uint64_t entries;
+  };
+
+  int AddColumn(const std::string &name, Flat::EType_t type);
+
+  std::string mFilename;
+  std::vector<Column_t> mColumns;
+  std::vector<Collection_t> mCollections;
+  int mEvent = -1;
+  uint64_t mEvents = 0;
+  uint64_t mBytes = 0;
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _FlatWriter_h_ **/
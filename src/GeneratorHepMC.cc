@@ -1,16 +1,20 @@
 #include "GeneratorHepMC.hh"
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithAnInteger.hh"
 #include "G4UIcommand.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4PhysicalConstants.hh"
 #include "G4Event.hh"
+#include "RootIO.hh"
 
 #include "HepMC3/ReaderAsciiHepMC2.h"
 #include "HepMC3/GenEvent.h"
 #include "HepMC3/GenVertex.h"
 #include "HepMC3/GenParticle.h"
 #include "HepMC3/FourVector.h"
+#include "HepMC3/GenHeavyIon.h"
+#include "HepMC3/Attribute.h"
 
 namespace G4me {
 
@@ -25,6 +29,17 @@ GeneratorHepMC::GeneratorHepMC()
   mHepMCFileNameCmd->SetParameterName("filename", false);
   mHepMCFileNameCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 
+  mHepMCSkipCmd = new G4UIcmdWithAnInteger("/hepmc/skip", this);
+  mHepMCSkipCmd->SetGuidance("Skip events in the HepMC file");
+  mHepMCSkipCmd->SetParameterName("nevents", false);
+  mHepMCSkipCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mHepMCSeekCmd = new G4UIcmdWithAnInteger("/hepmc/seek", this);
+  mHepMCSeekCmd->SetGuidance("Go to an event of the HepMC file, counted from the start of the file");
+  mHepMCSeekCmd->SetParameterName("event", false);
+  mHepMCSeekCmd->SetRange("event >= 0");
+  mHepMCSeekCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
   mHepMCCutsDirectory = new G4UIdirectory("/hepmc/cuts/");
 
   mHepMCCutsEta = new G4UIcommand("/hepmc/cuts/eta", this);
@@ -40,8 +55,37 @@ GeneratorHepMC::GeneratorHepMC()
 void
 GeneratorHepMC::SetNewValue(G4UIcommand *command, G4String value)
 {
-  if (command == mHepMCFileNameCmd) {
-    hepmc_reader = new HepMC3::ReaderAsciiHepMC2(value);
+  if (command == mHepMCFileNameCmd)
+    Open(value);
+  if (command == mHepMCSkipCmd && hepmc_reader)
+    Skip(mHepMCSkipCmd->GetNewIntValue(value));
+  if (command == mHepMCSeekCmd && hepmc_reader) {
+    /** the reader goes only forward, reopen the file to go back **/
+    auto event = mHepMCSeekCmd->GetNewIntValue(value);
+    if (event < mPosition) Open(mFileName);
+    Skip(event - mPosition);
+  }
+}
+
+/*****************************************************************/
+
+void
+GeneratorHepMC::Open(const std::string &filename)
+{
+  delete hepmc_reader;
+  hepmc_reader = new HepMC3::ReaderAsciiHepMC2(filename);
+  mFileName = filename;
+  mPosition = 0;
+}
+
+/*****************************************************************/
+
+void
+GeneratorHepMC::Skip(long nevents)
+{
+  for (long i = 0; i < nevents && !hepmc_reader->failed(); ++i) {
+    hepmc_reader->read_event(*hepmc_event);
+    mPosition++;
   }
 }
   
@@ -60,8 +104,26 @@ GeneratorHepMC::GeneratePrimaryVertex(G4Event *event) {
   
   hepmc_event->clear();
   hepmc_reader->read_event(*hepmc_event);
+  mPosition++;
   hepmc_event->set_units(HepMC3::Units::GEV, HepMC3::Units::CM);
 
+  /** event header **/
+  auto &header = RootIO::Instance()->GetEventHeader();
+  header.hepmc = mPosition - 1;
+  if (!hepmc_event->weights().empty())
+    header.weight = hepmc_event->weight();
+  auto process = hepmc_event->attribute<HepMC3::IntAttribute>("signal_process_id");
+  if (process) header.process = process->value();
+  auto heavy_ion = hepmc_event->heavy_ion();
+  if (heavy_ion) {
+    header.b = heavy_ion->impact_parameter;
+    header.npart = heavy_ion->Npart_proj + heavy_ion->Npart_targ;
+    header.ncoll = heavy_ion->Ncoll;
+  }
+  header.mult = 0;
+  for (auto const &hepmc_particle : hepmc_event->particles())
+    if (hepmc_particle->status() == 1) header.mult++;
+
   /** loop over vertices **/
   for (auto const &hepmc_vertex : hepmc_event->vertices()) {
     
@@ -6,6 +6,7 @@
 
 class G4UIdirectory;
 class G4UIcmdWithAString;
+class G4UIcmdWithAnInteger;
 class G4UIcommand;
 
 namespace HepMC3
@@ -30,13 +31,18 @@ public:
 protected:
 
   void SetNewValue(G4UIcommand *command, G4String value);
+  void Open(const std::string &filename);
+  void Skip(long nevents);
 
   std::string mFileName;
-  HepMC3::Reader   *hepmc_reader;
+  long mPosition = 0;  // events read from the start of the file
+  HepMC3::Reader   *hepmc_reader = nullptr;
   HepMC3::GenEvent *hepmc_event;
 
   G4UIdirectory *mHepMCDirectory;
   G4UIcmdWithAString *mHepMCFileNameCmd;
+  G4UIcmdWithAnInteger *mHepMCSkipCmd;
+  G4UIcmdWithAnInteger *mHepMCSeekCmd;
   G4UIdirectory *mHepMCCutsDirectory;
   G4UIcommand *mHepMCCutsEta;
 
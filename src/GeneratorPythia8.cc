@@ -73,6 +73,22 @@ GeneratorPythia8::GeneratePrimaryVertex(G4Event *event)
   // proceed with decays
   pythia->moreDecays();
 
+  // event header
+  auto &header = RootIO::Instance()->GetEventHeader();
+  header.process = pythia->info.code();
+  header.weight = pythia->info.weight();
+#if defined(PYTHIA_VERSION_INTEGER) && PYTHIA_VERSION_INTEGER >= 8300
+  auto hiinfo = pythia->info.hiInfo;
+#else
+  auto hiinfo = pythia->info.hiinfo;
+#endif
+  if (hiinfo) {
+    header.b = hiinfo->b();
+    header.npart = hiinfo->nPartProj() + hiinfo->nPartTarg();
+    header.ncoll = hiinfo->nCollTot();
+  }
+  header.mult = 0;
+  
   // add particles
   nParticles = pythia->event.size();
   for (int iparticle = 0; iparticle < nParticles; iparticle++) { // first particle is system
@@ -93,6 +109,7 @@ GeneratorPythia8::GeneratePrimaryVertex(G4Event *event)
     RootIO::Instance()->AddParticle(iparticle, pdg, parent, px, py, pz, et, vx, vy, vz, vt);
     
     if (aParticle.statusHepMC() != 1) continue;
+    header.mult++;
     if (aParticle.eta() < fCutsEtaMin ||
 	aParticle.eta() > fCutsEtaMax) continue;
 
@@ -10,6 +10,7 @@
 #include "GeneratorPythia8.hh"
 #include "GeneratorHepMC.hh"
 #include "G4Event.hh"
+#include "EventStats.hh"
 
 namespace G4me {
 
@@ -52,7 +53,9 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
 void
 PrimaryGeneratorAction::GeneratePrimaries(G4Event *event)
 {
+  EventStats::Instance()->Start(EventStats::kGeneration);
   mParticleSource->GeneratePrimaryVertex(event);
+  EventStats::Instance()->Stop(EventStats::kGeneration);
 }
 
 /*****************************************************************/
@@ -0,0 +1,272 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "Profiler.hh"
+#include "RootIO.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4Run.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4VProcess.hh"
+#include "G4ParticleTable.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+namespace G4me {
+
+Profiler *Profiler::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+Profiler::InitMessenger()
+{
+  mDirectory = new G4UIdirectory("/profile/");
+
+  mEnableCmd = new G4UIcmdWithABool("/profile/enable", this);
+  mEnableCmd->SetGuidance("Profile steps, tracks and time by particle, volume and process.");
+  mEnableCmd->SetGuidance("The summary is written to the output file and to a JSON file.");
+  mEnableCmd->SetParameterName("enable", true);
+  mEnableCmd->SetDefaultValue(true);
+  mEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+Profiler::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mEnableCmd)
+    mEnabled = mEnableCmd->GetNewBoolValue(value);
+}
+
+/*****************************************************************/
+
+void
+Profiler::BeginOfRunAction(const G4Run *aRun)
+{
+  mParticleCounters.clear();
+  mVolumeCounters.clear();
+  mProcessCounters.clear();
+  mProcessIndex.clear();
+  mProcesses.clear();
+  mLastProcess = nullptr;
+  mLastProcessIndex = -1;
+#ifndef G4ME_STEPPING_ACTION
+  if (mEnabled) std::cout << " --- profiler: stepping action not built, profiling is disabled" << std::endl;
+  mEnabled = false;
+#endif
+}
+
+/*****************************************************************/
+
+void
+Profiler::EndOfRunAction(const G4Run *aRun)
+{
+  if (!mEnabled) return;
+  Print(aRun->GetNumberOfEvent());
+  WriteTree();
+  auto io = RootIO::Instance();
+  WriteJSON(Form("%s.%03d%s.profile.json", io->GetFilePrefix().c_str(), aRun->GetRunID(), io->GetFileSuffix().c_str()));
+}
+
+/*****************************************************************/
+
+void
+Profiler::PreTrack(const G4Track *aTrack)
+{
+  Get(mParticleCounters, aTrack->GetParticleDefinition()->GetParticleDefinitionID()).tracks++;
+  mLastTime = std::chrono::steady_clock::now();
+}
+
+/*****************************************************************/
+
+void
+Profiler::Step(const G4Step *aStep)
+{
+  /** the time since the previous step is assigned to this step **/
+  auto now = std::chrono::steady_clock::now();
+  double time = std::chrono::duration<double>(now - mLastTime).count();
+  mLastTime = now;
+
+  auto &particle = Get(mParticleCounters, aStep->GetTrack()->GetParticleDefinition()->GetParticleDefinitionID());
+  particle.steps++;
+  particle.time += time;
+
+  auto &volume = Get(mVolumeCounters, aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume()->GetInstanceID());
+  volume.steps++;
+  volume.time += time;
+
+  auto process = aStep->GetPostStepPoint()->GetProcessDefinedStep();
+  if (process != mLastProcess) {
+    mLastProcess = process;
+    auto it = mProcessIndex.find(process);
+    if (it != mProcessIndex.end()) mLastProcessIndex = it->second;
+    else {
+      mLastProcessIndex = mProcessIndex[process] = mProcesses.size();
+      mProcesses.push_back(process);
+    }
+  }
+  auto &counter = Get(mProcessCounters, mLastProcessIndex);
+  counter.steps++;
+  counter.time += time;
+}
+
+/*****************************************************************/
+
+void
+Profiler::Print(int nevents)
+{
+  long steps = 0;
+  for (const auto &counter : mParticleCounters) steps += counter.steps;
+  std::cout << " --- profiler: " << steps << " steps, " << (nevents > 0 ? (double)steps / nevents : 0.) << " steps/event" << std::endl;
+
+  auto particles = std::vector<std::pair<double, std::string>>();
+  auto particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    auto particle = particleIterator->value();
+    auto id = particle->GetParticleDefinitionID();
+    if (id < 0 || id >= mParticleCounters.size() || mParticleCounters[id].steps == 0) continue;
+    particles.push_back({mParticleCounters[id].time, particle->GetParticleName()});
+  }
+  std::sort(particles.rbegin(), particles.rend());
+
+  auto volumes = std::vector<std::pair<double, std::string>>();
+  for (auto lv : *G4LogicalVolumeStore::GetInstance()) {
+    auto id = lv->GetInstanceID();
+    if (id < 0 || id >= mVolumeCounters.size() || mVolumeCounters[id].steps == 0) continue;
+    volumes.push_back({mVolumeCounters[id].time, lv->GetName()});
+  }
+  std::sort(volumes.rbegin(), volumes.rend());
+
+  auto processes = std::vector<std::pair<double, std::string>>();
+  for (int i = 0; i < mProcesses.size(); ++i)
+    processes.push_back({mProcessCounters[i].time, mProcesses[i] ? mProcesses[i]->GetProcessName() : "none"});
+  std::sort(processes.rbegin(), processes.rend());
+
+  std::cout << " --- profiler report (time spent in stepping, top 10)" << std::endl;
+  std::cout << "     particles :";
+  for (int i = 0; i < particles.size() && i < 10; ++i) std::cout << " " << particles[i].second << " (" << particles[i].first << " s)";
+  std::cout << std::endl << "     volumes   :";
+  for (int i = 0; i < volumes.size() && i < 10; ++i) std::cout << " " << volumes[i].second << " (" << volumes[i].first << " s)";
+  std::cout << std::endl << "     processes :";
+  for (int i = 0; i < processes.size() && i < 10; ++i) std::cout << " " << processes[i].second << " (" << processes[i].first << " s)";
+  std::cout << std::endl;
+}
+
+/*****************************************************************/
+
+void
+Profiler::WriteTree()
+{
+  auto file = RootIO::Instance()->GetFile();
+  if (!file) return;
+  file->cd();
+
+  int category, pdg, type;
+  char name[128];
+  Long64_t tracks, steps;
+  double time;
+  auto tree = new TTree("Profile", "Profiler tree");
+  tree->Branch("category" , &category , "category/I");
+  tree->Branch("name"     , &name     , "name/C");
+  tree->Branch("pdg"      , &pdg      , "pdg/I");
+  tree->Branch("type"     , &type     , "type/I");
+  tree->Branch("tracks"   , &tracks   , "tracks/L");
+  tree->Branch("steps"    , &steps    , "steps/L");
+  tree->Branch("time"     , &time     , "time/D");
+
+  auto fill = [&](int acategory, const std::string &aname, int apdg, int atype, const Counter_t &counter) {
+    category = acategory;
+    std::strncpy(name, aname.c_str(), sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    pdg = apdg;
+    type = atype;
+    tracks = counter.tracks;
+    steps = counter.steps;
+    time = counter.time;
+    tree->Fill();
+  };
+  
+  auto particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    auto particle = particleIterator->value();
+    auto id = particle->GetParticleDefinitionID();
+    if (id < 0 || id >= mParticleCounters.size() || mParticleCounters[id].tracks == 0) continue;
+    fill(kParticle, particle->GetParticleName(), particle->GetPDGEncoding(), -1, mParticleCounters[id]);
+  }
+  for (auto lv : *G4LogicalVolumeStore::GetInstance()) {
+    auto id = lv->GetInstanceID();
+    if (id < 0 || id >= mVolumeCounters.size() || mVolumeCounters[id].steps == 0) continue;
+    fill(kVolume, lv->GetName(), 0, -1, mVolumeCounters[id]);
+  }
+  for (int i = 0; i < mProcesses.size(); ++i) {
+    auto process = mProcesses[i];
+    fill(kProcess, process ? process->GetProcessName() : "none", 0, process ? process->GetProcessType() : -1, mProcessCounters[i]);
+  }
+  
+  tree->Write();
+}
+
+/*****************************************************************/
+
+void
+Profiler::WriteJSON(const std::string &filename)
+{
+  std::ofstream fout(filename);
+  auto entry = [&](const std::string &name, const Counter_t &counter, const std::string &extra) {
+    fout << "    {\"name\": \"" << name << "\"" << extra
+	 << ", \"tracks\": " << counter.tracks
+	 << ", \"steps\": " << counter.steps
+	 << ", \"time\": " << counter.time << "}";
+  };
+
+  fout << "{" << std::endl << "  \"particles\": [";
+  bool first = true;
+  auto particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    auto particle = particleIterator->value();
+    auto id = particle->GetParticleDefinitionID();
+    if (id < 0 || id >= mParticleCounters.size() || mParticleCounters[id].tracks == 0) continue;
+    fout << (first ? "" : ",") << std::endl;
+    entry(particle->GetParticleName(), mParticleCounters[id], ", \"pdg\": " + std::to_string(particle->GetPDGEncoding()));
+    first = false;
+  }
+  fout << std::endl << "  ]," << std::endl << "  \"volumes\": [";
+  first = true;
+  for (auto lv : *G4LogicalVolumeStore::GetInstance()) {
+    auto id = lv->GetInstanceID();
+    if (id < 0 || id >= mVolumeCounters.size() || mVolumeCounters[id].steps == 0) continue;
+    fout << (first ? "" : ",") << std::endl;
+    entry(lv->GetName(), mVolumeCounters[id], "");
+    first = false;
+  }
+  fout << std::endl << "  ]," << std::endl << "  \"processes\": [";
+  first = true;
+  for (int i = 0; i < mProcesses.size(); ++i) {
+    auto process = mProcesses[i];
+    fout << (first ? "" : ",") << std::endl;
+    entry(process ? process->GetProcessName() : "none", mProcessCounters[i],
+	  ", \"type\": \"" + (process ? G4VProcess::GetProcessTypeName(process->GetProcessType()) : G4String("none")) + "\"");
+    first = false;
+  }
+  fout << std::endl << "  ]" << std::endl << "}" << std::endl;
+  fout.close();
+  std::cout << " --- profiler: summary written to " << filename << std::endl;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,92 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _Profiler_h_
+#define _Profiler_h_
+
+#include "G4UImessenger.hh"
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+class G4UIdirectory;
+class G4UIcmdWithABool;
+class G4Run;
+class G4Track;
+class G4Step;
+class G4VProcess;
+
+namespace G4me {
+
+/** step counts, track counts and wall time
+    by particle, logical volume and process **/
+  
+class Profiler : public G4UImessenger
+{
+  
+public:
+
+  static Profiler *Instance() {
+    if (!mInstance) mInstance = new Profiler();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void BeginOfRunAction(const G4Run *aRun);
+  void EndOfRunAction(const G4Run *aRun);
+
+  bool IsEnabled() const { return mEnabled; };
+  
+  void PreTrack(const G4Track *aTrack);
+  void Step(const G4Step *aStep);
+  
+private:
+
+  Profiler() = default;
+
+  struct Counter_t {
+    long tracks = 0;
+    long steps = 0;
+    double time = 0.; // s
+  };
+
+  enum ECategory_t {
+    kParticle,
+    kVolume,
+    kProcess
+  };
+  
+  Counter_t &Get(std::vector<Counter_t> &counters, int index) {
+    if (index >= counters.size()) counters.resize(index + 1);
+    return counters[index];
+  };
+  
+  void WriteTree();
+  void WriteJSON(const std::string &filename);
+  void Print(int nevents);
+  
+  static Profiler *mInstance;
+
+  bool mEnabled = false;
+
+  /** the application runs the sequential run manager,
+      counters need no synchronisation **/
+  std::vector<Counter_t> mParticleCounters; // by particle definition ID
+  std::vector<Counter_t> mVolumeCounters;   // by logical volume instance ID
+  std::vector<Counter_t> mProcessCounters;  // by process index
+  std::unordered_map<const G4VProcess *, int> mProcessIndex;
+  std::vector<const G4VProcess *> mProcesses;
+  const G4VProcess *mLastProcess = nullptr;
+  int mLastProcessIndex = -1;
+  std::chrono::steady_clock::time_point mLastTime;
+  
+  G4UIdirectory *mDirectory;
+  G4UIcmdWithABool *mEnableCmd;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _Profiler_h_ **/
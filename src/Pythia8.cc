@@ -25,6 +25,17 @@ Pythia8::Instance()
 
 /*****************************************************************/
 
+void
+Pythia8::Reseed(int seed)
+{
+  /** only if Pythia8 is in use, not to construct it for nothing **/
+  if (!mPythia) return;
+  mPythia->readString("Random:seed = " + std::to_string(seed));
+  mPythia->rndm.init(seed);
+}
+
+/*****************************************************************/
+
 Pythia8::Pythia8()
 {
   mPythia8Directory = new G4UIdirectory("/pythia8/");
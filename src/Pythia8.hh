@@ -21,6 +21,7 @@ class Pythia8 : public G4UImessenger
 public:
   
   static ::Pythia8::Pythia *Instance(); 
+  static void Reseed(int seed);
   
 private:
 
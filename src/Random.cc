@@ -0,0 +1,180 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "Random.hh"
+#include "SplitMixEngine.hh"
+#include "RunManager.hh"
+#include "Pythia8.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4Run.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+#include "CLHEP/Random/RanluxEngine.h"
+#include "CLHEP/Random/Ranlux64Engine.h"
+#include "CLHEP/Random/MTwistEngine.h"
+#include "CLHEP/Random/RanecuEngine.h"
+#if __has_include("CLHEP/Random/RanluxppEngine.h")
+#include "CLHEP/Random/RanluxppEngine.h"
+#define G4ME_HAS_RANLUXPP
+#endif
+#include <sstream>
+
+namespace G4me {
+
+Random *Random::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+Random::InitMessenger()
+{
+  /** the /random/ and /run/ directories belong to Geant4 **/
+  mPerEventCmd = new G4UIcmdWithABool("/random/perEvent", this);
+  mPerEventCmd->SetGuidance("Derive the seeds of each event from the master seed, the run and the event number.");
+  mPerEventCmd->SetParameterName("enabled", false);
+  mPerEventCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMasterSeedCmd = new G4UIcmdWithAnInteger("/random/masterSeed", this);
+  mMasterSeedCmd->SetGuidance("Master seed of the per-event seeds, 0 to draw it from the engine at the first run.");
+  mMasterSeedCmd->SetParameterName("seed", false);
+  mMasterSeedCmd->SetRange("seed >= 0");
+  mMasterSeedCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mResimulateCmd = new G4UIcommand("/run/resimulate", this);
+  mResimulateCmd->SetGuidance("Simulate again events of a run, starting from an event number.");
+  mResimulateCmd->SetGuidance("With the same macro and master seed the events are the same as in the original run,");
+  mResimulateCmd->SetGuidance("a long run is resumed with the remaining events after the last completed one.");
+  mResimulateCmd->SetGuidance("The master seed is stored in the Events tree of the output, 0 keeps the current one,");
+  mResimulateCmd->SetGuidance("another one is used for these events only.");
+  mResimulateCmd->SetGuidance("With HepMC input, hepmc is the position in the file stored in Events.hepmc,");
+  mResimulateCmd->SetGuidance("it can be omitted only for the first run of a session that did not skip events.");
+  mResimulateCmd->SetParameter(new G4UIparameter("run", 'i', false));
+  mResimulateCmd->SetParameter(new G4UIparameter("event", 'i', false));
+  auto nevents = new G4UIparameter("nevents", 'i', true);
+  nevents->SetDefaultValue(1);
+  mResimulateCmd->SetParameter(nevents);
+  auto master = new G4UIparameter("master", 'i', true);
+  master->SetDefaultValue(0);
+  master->SetParameterRange("master >= 0");
+  mResimulateCmd->SetParameter(master);
+  auto hepmc = new G4UIparameter("hepmc", 'i', true);
+  hepmc->SetDefaultValue(-1);
+  mResimulateCmd->SetParameter(hepmc);
+  mResimulateCmd->AvailableForStates(G4State_Idle);
+
+  mEngineCmd = new G4UIcmdWithAString("/random/engine", this);
+  mEngineCmd->SetGuidance("Random engine of Geant4, to be selected before /random/setSeeds.");
+  mEngineCmd->SetGuidance("  mixmax     default of Geant4");
+  mEngineCmd->SetGuidance("  ranlux     RANLUX, luxury level 3");
+  mEngineCmd->SetGuidance("  ranlux4    RANLUX, luxury level 4, slowest");
+  mEngineCmd->SetGuidance("  ranlux64   64-bit RANLUX");
+  mEngineCmd->SetGuidance("  ranluxpp   RANLUX++, if available in CLHEP");
+  mEngineCmd->SetGuidance("  mtwist     Mersenne twister");
+  mEngineCmd->SetGuidance("  ranecu     RANECU, small period");
+  mEngineCmd->SetGuidance("  splitmix   counter-based SplitMix64, fastest, least tested");
+  mEngineCmd->SetParameterName("engine", false);
+  mEngineCmd->SetCandidates("mixmax ranlux ranlux4 ranlux64 ranluxpp mtwist ranecu splitmix");
+  mEngineCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+Random::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mPerEventCmd)
+    mPerEvent = mPerEventCmd->GetNewBoolValue(value);
+  if (command == mMasterSeedCmd)
+    mMasterSeed = mMasterSeedCmd->GetNewIntValue(value);
+  if (command == mEngineCmd)
+    SetEngine(value);
+  if (command == mResimulateCmd) {
+    int run, event, nevents;
+    long master, hepmc;
+    std::istringstream iss(value);
+    iss >> run >> event >> nevents >> master >> hepmc;
+    auto manager = dynamic_cast<RunManager *>(G4RunManager::GetRunManager());
+    if (!mPerEvent || !manager) {
+      std::cout << " --- random: /run/resimulate needs /random/perEvent true" << std::endl;
+      return;
+    }
+    /** the master seed of the session is back after the events **/
+    auto session = mMasterSeed;
+    if (master > 0) mMasterSeed = master;
+    manager->Resimulate(run, event, nevents, hepmc);
+    if (master > 0) mMasterSeed = session;
+  }
+}
+
+/*****************************************************************/
+
+bool
+Random::SetEngine(const std::string &name)
+{
+  CLHEP::HepRandomEngine *engine = nullptr;
+  if (name == "mixmax") engine = new CLHEP::MixMaxRng;
+  else if (name == "ranlux") engine = new CLHEP::RanluxEngine(19780503, 3);
+  else if (name == "ranlux4") engine = new CLHEP::RanluxEngine(19780503, 4);
+  else if (name == "ranlux64") engine = new CLHEP::Ranlux64Engine;
+#ifdef G4ME_HAS_RANLUXPP
+  else if (name == "ranluxpp") engine = new CLHEP::RanluxppEngine;
+#endif
+  else if (name == "mtwist") engine = new CLHEP::MTwistEngine;
+  else if (name == "ranecu") engine = new CLHEP::RanecuEngine;
+  else if (name == "splitmix") engine = new SplitMixEngine;
+  if (!engine) {
+    std::cout << " --- random: engine " << name << " is not available" << std::endl;
+    return false;
+  }
+  CLHEP::HepRandom::setTheEngine(engine);
+  delete mEngine;
+  mEngine = engine;
+  std::cout << " --- random: engine " << engine->name() << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+void
+Random::BeginOfRunAction(const G4Run *aRun)
+{
+  /** without per-event seeds Pythia8 follows the engine once per run **/
+  if (!mPerEvent) {
+    Pythia8::Reseed((long)(CLHEP::HepRandom::getTheEngine()->flat() * 900000000.) + 1);
+    return;
+  }
+  std::cout << " --- random: run " << aRun->GetRunID() << ", master seed " << GetMasterSeed() << std::endl;
+}
+
+/*****************************************************************/
+
+long
+Random::GetMasterSeed()
+{
+  /** drawn once, it follows /random/setSeeds but not the runs before **/
+  if (mMasterSeed == 0)
+    mMasterSeed = (long)(CLHEP::HepRandom::getTheEngine()->flat() * 900000000.) + 1;
+  return mMasterSeed;
+}
+
+/*****************************************************************/
+
+void
+Random::SeedEvent(int runID, int eventID)
+{
+  if (!mPerEvent) return;
+  uint64_t state = GetMasterSeed();
+  state = SplitMix64(state) ^ ((uint64_t)(uint32_t)runID << 32 | (uint32_t)eventID);
+  for (auto &seed : mSeeds)
+    seed = (long)(SplitMix64(state) % 900000000) + 1;
+  long seeds[3] = {mSeeds[0], mSeeds[1], 0};
+  CLHEP::HepRandom::setTheSeeds(seeds);
+  Pythia8::Reseed(mSeeds[0]);
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,79 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _Random_h_
+#define _Random_h_
+
+#include "G4UImessenger.hh"
+#include <cstdint>
+#include <string>
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithAString;
+class G4Run;
+
+namespace CLHEP {
+class HepRandomEngine;
+}
+
+namespace G4me {
+
+/** per-event seeding. the seeds of Geant4 and Pythia8 are derived
+    at the start of each event from the master seed, the run number
+    and the event number only, so that any event can be simulated
+    again on its own, whatever the number of jobs and the events
+    that were simulated before it. the engine of Geant4 can be
+    chosen among the CLHEP ones and a counter-based one **/
+
+class Random : public G4UImessenger
+{
+
+public:
+
+  static Random *Instance() {
+    if (!mInstance) mInstance = new Random();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void BeginOfRunAction(const G4Run *aRun);
+
+  bool SetEngine(const std::string &name);
+  bool IsPerEvent() const { return mPerEvent; };
+  long GetMasterSeed();
+  void SeedEvent(int runID, int eventID);
+  long GetSeed(int i) const { return mSeeds[i]; };
+
+  static uint64_t SplitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  };
+
+private:
+
+  Random() = default;
+
+  static Random *mInstance;
+
+  bool mPerEvent = true;
+  long mMasterSeed = 0;      // 0 to draw it from the engine at the first run
+  long mSeeds[2] = {0, 0};   // seeds of the current event
+  CLHEP::HepRandomEngine *mEngine = nullptr;  // owned, nullptr for the default one
+
+  G4UIcmdWithABool *mPerEventCmd;
+  G4UIcmdWithAnInteger *mMasterSeedCmd;
+  G4UIcommand *mResimulateCmd;
+  G4UIcmdWithAString *mEngineCmd;
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _Random_h_ **/
@@ -6,6 +6,9 @@
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIparameter.hh"
 #include "G4Run.hh"
 #include "G4Event.hh"
 #include "G4Track.hh"
@@ -13,13 +16,25 @@
 #include "G4ParticleDefinition.hh"
 #include "G4VProcess.hh"
 #include "G4ProcessType.hh"
+#include "Randomize.hh"
+#include "Random.hh"
 #include "TFile.h"
 #include "TTree.h"
 #include "PrimaryParticleInformation.hh"
+#include "EventStats.hh"
+#include "StreamWriter.hh"
+#include "StreamFrame.hh"
+#include "FlatWriter.hh"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <fnmatch.h>
 
 namespace G4me {
 
 RootIO *RootIO::mInstance = nullptr;
+const char *RootIO::kCollectionName[3] = {"hits", "tracks", "particles"};
+const char *RootIO::kTreeName[3] = {"Hits", "Tracks", "Particles"};
 
 /*****************************************************************/
 
@@ -37,6 +52,44 @@ RootIO::InitMessenger()
   mSaveParticlesCmd->SetGuidance("Save the generator particles.");
   mSaveParticlesCmd->SetParameterName("prefix", false);
   mSaveParticlesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMaxEventsCmd = new G4UIcmdWithAnInteger("/io/maxEvents", this);
+  mMaxEventsCmd->SetGuidance("Maximum number of events per output file, 0 for no limit.");
+  mMaxEventsCmd->SetParameterName("events", false);
+  mMaxEventsCmd->SetRange("events >= 0");
+  mMaxEventsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMaxBytesCmd = new G4UIcmdWithADouble("/io/maxBytes", this);
+  mMaxBytesCmd->SetGuidance("Maximum size of an output file in bytes, 0 for no limit.");
+  mMaxBytesCmd->SetGuidance("The file is closed after the first event that exceeds it.");
+  mMaxBytesCmd->SetParameterName("bytes", false);
+  mMaxBytesCmd->SetRange("bytes >= 0.");
+  mMaxBytesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mStreamCmd = new G4UIcmdWithAString("/io/stream", this);
+  mStreamCmd->SetGuidance("Stream the events to a named pipe or Unix socket instead of writing a file.");
+  mStreamCmd->SetGuidance("The consumer must have created it, none to write files again.");
+  mStreamCmd->SetParameterName("path", false);
+  mStreamCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mStreamDepthCmd = new G4UIcmdWithAnInteger("/io/streamDepth", this);
+  mStreamDepthCmd->SetGuidance("Number of events buffered for the stream before the simulation waits.");
+  mStreamDepthCmd->SetParameterName("events", false);
+  mStreamDepthCmd->SetRange("events > 0");
+  mStreamDepthCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mFormatCmd = new G4UIcmdWithAString("/io/format", this);
+  mFormatCmd->SetGuidance("Output file format: ROOT trees or flat columnar file for memory mapping.");
+  mFormatCmd->SetParameterName("format", false);
+  mFormatCmd->SetCandidates("root flat");
+  mFormatCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mBranchesCmd = new G4UIcommand("/io/branches", this);
+  mBranchesCmd->SetGuidance("Enable or disable the output columns matching a pattern, from the next run.");
+  mBranchesCmd->SetGuidance("The pattern is matched against <collection>.<column>, e.g. tracks.v* or hits.*");
+  mBranchesCmd->SetParameter(new G4UIparameter("pattern", 's', false));
+  mBranchesCmd->SetParameter(new G4UIparameter("enabled", 'b', false));
+  mBranchesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 };
 
 /*****************************************************************/
@@ -48,6 +101,87 @@ RootIO::SetNewValue(G4UIcommand *command, G4String value)
     mFilePrefix = value;
   if (command == mSaveParticlesCmd)
     mSaveParticles = mSaveParticlesCmd->GetNewBoolValue(value);
+  if (command == mMaxEventsCmd)
+    mMaxEvents = mMaxEventsCmd->GetNewIntValue(value);
+  if (command == mMaxBytesCmd)
+    mMaxBytes = mMaxBytesCmd->GetNewDoubleValue(value);
+  if (command == mStreamCmd)
+    mStreamPath = value.compare("none") == 0 ? "" : value;
+  if (command == mStreamDepthCmd)
+    mStreamDepth = mStreamDepthCmd->GetNewIntValue(value);
+  if (command == mFormatCmd)
+    mFlatFormat = value.compare("flat") == 0;
+  if (command == mBranchesCmd) {
+    std::istringstream iss(value);
+    std::string pattern, enabled;
+    iss >> pattern >> enabled;
+    int matched = 0;
+    auto match = [&](const std::string &collection, Column_t &column) {
+      auto name = collection + "." + column.name;
+      if (fnmatch(pattern.c_str(), name.c_str(), 0) != 0) return;
+      column.enabled = G4UIcommand::ConvertToBool(enabled.c_str());
+      matched++;
+    };
+    for (int collection = 0; collection < kNCollections; ++collection)
+      for (auto &column : mSchema[collection]) match(kCollectionName[collection], column);
+    for (auto &column : mEventSchema) match("events", column);
+    if (!matched) std::cout << " --- io: no column matches " << pattern << std::endl;
+  }
+}
+
+/*****************************************************************/
+
+void
+RootIO::InitSchema()
+{
+#define G4ME_HITS_COLUMN(type, name, leaf) mSchema[kHits].push_back({#name, #leaf[0], mHits.name, sizeof(type), true});
+#define G4ME_TRACKS_COLUMN(type, name, leaf) mSchema[kTracks].push_back({#name, #leaf[0], mTracks.name, sizeof(type), true});
+#define G4ME_PARTICLES_COLUMN(type, name, leaf) mSchema[kParticles].push_back({#name, #leaf[0], mParticles.name, sizeof(type), true});
+  G4ME_HITS_SCHEMA(G4ME_HITS_COLUMN)
+  G4ME_TRACKS_SCHEMA(G4ME_TRACKS_COLUMN)
+  G4ME_PARTICLES_SCHEMA(G4ME_PARTICLES_COLUMN)
+#define G4ME_EVENTS_COLUMN(type, name, leaf) mEventSchema.push_back({#name, #leaf[0], &mEventHeader.name, sizeof(type), true});
+  G4ME_EVENTS_SCHEMA(G4ME_EVENTS_COLUMN)
+#undef G4ME_EVENTS_COLUMN
+#undef G4ME_HITS_COLUMN
+#undef G4ME_TRACKS_COLUMN
+#undef G4ME_PARTICLES_COLUMN
+  ResetEventHeader();
+}
+
+/*****************************************************************/
+
+void
+RootIO::ResetEventHeader()
+{
+  mEventHeader.process = -1;
+  mEventHeader.weight = 1.;
+  mEventHeader.b = -1.;
+  mEventHeader.npart = -1;
+  mEventHeader.ncoll = -1;
+  mEventHeader.mult = -1;
+  mEventHeader.hepmc = -1;
+}
+
+/*****************************************************************/
+
+int *
+RootIO::GetSize(int collection)
+{
+  if (collection == kHits) return &mHits.n;
+  if (collection == kTracks) return &mTracks.n;
+  return &mParticles.n;
+}
+
+/*****************************************************************/
+
+std::string
+RootIO::GetFileName(int runID, int chunk) const
+{
+  auto extension = mFlatFormat ? "g4f" : "root";
+  if (!IsRotating())
+    return Form("%s.%03d%s.%s", mFilePrefix.c_str(), runID, mFileSuffix.c_str(), extension);
+  return Form("%s.%03d%s.%04d.%s", mFilePrefix.c_str(), runID, mFileSuffix.c_str(), chunk, extension);
 }
 
 /*****************************************************************/
@@ -55,8 +189,17 @@ RootIO::SetNewValue(G4UIcommand *command, G4String value)
 void
 RootIO::BeginOfRunAction(const G4Run *aRun)
 {
-  std::string filename = Form("%s.%03d.root", mFilePrefix.c_str(), aRun->GetRunID());
-  Open(filename);
+  mRunID = aRun->GetRunID();
+  mRotate = false;
+  mChunks.clear();
+  if (IsStreaming()) {
+    mStream = new StreamWriter;
+    if (!mStream->Open(mStreamPath, mStreamDepth)) {
+      delete mStream;
+      mStream = nullptr;
+    }
+  }
+  else Open(GetFileName(mRunID, 0));
   ResetHits();
   ResetTracks();
   ResetParticles();
@@ -67,7 +210,20 @@ RootIO::BeginOfRunAction(const G4Run *aRun)
 void
 RootIO::EndOfRunAction(const G4Run *aRun)
 {
+  if (IsStreaming()) {
+    if (!mStream) return;
+    mStream->Close();
+    std::cout << " --- stream: " << mStream->GetFrames() << " events, "
+	      << mStream->GetBytes() / 1048576. << " MB sent" << std::endl;
+    delete mStream;
+    mStream = nullptr;
+    return;
+  }
   Close();
+  if (!IsRotating()) return;
+  auto manifest = Form("%s.%03d%s.json", mFilePrefix.c_str(), mRunID, mFileSuffix.c_str());
+  WriteManifest(manifest, mRunID, mChunks);
+  std::cout << " --- output written in " << mChunks.size() << " files, see " << manifest << std::endl;
 }
 
 /*****************************************************************/
@@ -75,6 +231,14 @@ RootIO::EndOfRunAction(const G4Run *aRun)
 void
 RootIO::BeginOfEventAction(const G4Event *aEvent)
 {
+  /** rotate here rather than after the last event of a file,
+      so that the end of the run does not leave an empty file.
+      the generator particles of this event are already in the buffers,
+      which are not touched by closing and opening **/
+  if (!mRotate) return;
+  mRotate = false;
+  Close();
+  Open(GetFileName(mRunID, mChunks.size()));
 }
 
 /*****************************************************************/
@@ -82,12 +246,107 @@ RootIO::BeginOfEventAction(const G4Event *aEvent)
 void
 RootIO::EndOfEventAction(const G4Event *aEvent)
 {
-  FillHits();
-  FillTracks();
-  FillParticles();
+  auto stats = EventStats::Instance();
+  stats->Start(EventStats::kOutput);
+  ComputeIndices();
+  mEventHeader.event = aEvent->GetEventID();
+  mEventHeader.run = mRunID;
+  mEventHeader.ntracks = mTracks.n;
+  mEventHeader.nhits = mHits.n;
+  mEventHeader.nparticles = mSaveParticles ? mParticles.n : 0;
+  auto random = Random::Instance();
+  auto seeds = random->IsPerEvent() ? nullptr : CLHEP::HepRandom::getTheSeeds();
+  mEventHeader.seed0 = random->IsPerEvent() ? random->GetSeed(0) : seeds ? seeds[0] : 0;
+  mEventHeader.seed1 = random->IsPerEvent() ? random->GetSeed(1) : seeds && seeds[0] ? seeds[1] : 0;
+  mEventHeader.master = random->IsPerEvent() ? random->GetMasterSeed() : 0;
+  if (IsStreaming()) StreamEvent(aEvent);
+  else if (mFlat) FillFlat(aEvent);
+  else {
+    FillHits();
+    FillTracks();
+    FillParticles();
+    mTreeEvents->Fill();
+  }
+  stats->Stop(EventStats::kOutput);
+  stats->EndOfEvent(mTracks.n, mHits.n, mSaveParticles ? mParticles.n : 0);
+  if (mTreeEventStats) mTreeEventStats->Fill();
+  stats->Reset();
   ResetHits();
   ResetTracks();
   ResetParticles();
+  ResetEventHeader();
+  if (IsStreaming()) return;
+
+  auto &chunk = mChunks.back();
+  if (chunk.events == 0) chunk.first = aEvent->GetEventID();
+  chunk.last = aEvent->GetEventID();
+  chunk.events++;
+  auto bytes = mFlat ? mFlat->GetBytes() : mFile->GetEND();
+  mRotate = (mMaxEvents > 0 && chunk.events >= mMaxEvents) || (mMaxBytes > 0. && bytes >= mMaxBytes);
+}
+
+/*****************************************************************/
+
+void
+RootIO::ComputeIndices()
+{
+  /** ancestry, parents are created before their daughters **/
+  for (int id = 0; id < mTracks.n; ++id) {
+    auto parent = mTracks.parent[id];
+    if (parent < 0 || parent >= id) {
+      mTracks.ancestor[id] = id;
+      mTracks.depth[id] = parent < 0 ? 0 : -1;
+      continue;
+    }
+    mTracks.ancestor[id] = mTracks.ancestor[parent];
+    mTracks.depth[id] = mTracks.depth[parent] + 1;
+  }
+
+  /** hit ranges. a track is normally transported in one go, so its
+      hits are already contiguous, otherwise they are grouped by track
+      keeping their order, with a counting sort over all the columns **/
+  bool grouped = true;
+  for (int id = 0; id < mTracks.n; ++id) {
+    mTracks.hit0[id] = -1;
+    mTracks.nhits[id] = 0;
+  }
+  for (int i = 0; i < mHits.n; ++i) {
+    auto id = mHits.trkid[i];
+    if (id < 0 || id >= mTracks.n) continue;
+    if (mTracks.nhits[id] == 0) mTracks.hit0[id] = i;
+    else if (mHits.trkid[i - 1] != id) grouped = false;
+    mTracks.nhits[id]++;
+  }
+  if (!grouped) {
+    int next = 0;
+    mHitCursor.resize(mTracks.n);
+    for (int id = 0; id < mTracks.n; ++id) {
+      mTracks.hit0[id] = mTracks.nhits[id] ? next : -1;
+      mHitCursor[id] = next;
+      next += mTracks.nhits[id];
+    }
+    mHitOrder.resize(mHits.n);
+    for (int i = 0; i < mHits.n; ++i) {
+      auto id = mHits.trkid[i];
+      mHitOrder[i] = (id < 0 || id >= mTracks.n) ? next++ : mHitCursor[id]++;
+    }
+    for (const auto &column : mSchema[kHits]) {
+      auto data = (char *)column.data;
+      mHitBuffer.resize(mHits.n * column.size);
+      for (int i = 0; i < mHits.n; ++i)
+	std::memcpy(mHitBuffer.data() + mHitOrder[i] * column.size, data + i * column.size, column.size);
+      std::memcpy(data, mHitBuffer.data(), mHits.n * column.size);
+    }
+  }
+
+  /** reverse index of the generator particles **/
+  if (!mSaveParticles) return;
+  for (int ip = 0; ip < mParticles.n; ++ip)
+    mParticles.track[ip] = -1;
+  for (int id = 0; id < mTracks.n; ++id) {
+    auto ip = mTracks.particle[id];
+    if (ip >= 0 && ip < mParticles.n) mParticles.track[ip] = id;
+  }
 }
 
 /*****************************************************************/
@@ -95,50 +354,39 @@ RootIO::EndOfEventAction(const G4Event *aEvent)
 void
 RootIO::Open(std::string filename) {
   
+  mChunks.push_back({filename, -1, -1, 0, 0});
+  if (mFlatFormat) {
+    OpenFlat(filename);
+    return;
+  }
+
   mFile = TFile::Open(filename.c_str(), "RECREATE");
   
-  mTreeHits = new TTree("Hits", "RootIO tree");
-  mTreeHits->Branch("n"      , &mHits.n      , "n/I");
-  mTreeHits->Branch("trkid"  , &mHits.trkid  , "trkid[n]/I");
-  mTreeHits->Branch("trklen" , &mHits.trklen , "trklen[n]/F");
-  mTreeHits->Branch("edep"   , &mHits.edep   , "edep[n]/F");
-  mTreeHits->Branch("x"      , &mHits.x      , "x[n]/F");
-  mTreeHits->Branch("y"      , &mHits.y      , "y[n]/F");
-  mTreeHits->Branch("z"      , &mHits.z      , "z[n]/F");
-  mTreeHits->Branch("t"      , &mHits.t      , "t[n]/F");
-  mTreeHits->Branch("lyrid"  , &mHits.lyrid  , "lyrid[n]/I");
-  
-  mTreeTracks = new TTree("Tracks", "RootIO tree");
-  mTreeTracks->Branch("n"        , &mTracks.n        , "n/I");
-  mTreeTracks->Branch("proc"     , &mTracks.proc     , "proc[n]/B");
-  mTreeTracks->Branch("sproc"    , &mTracks.sproc    , "sproc[n]/B");
-  mTreeTracks->Branch("status"   , &mTracks.status   , "status[n]/I");
-  mTreeTracks->Branch("parent"   , &mTracks.parent   , "parent[n]/I");
-  mTreeTracks->Branch("particle" , &mTracks.particle , "particle[n]/I");
-  mTreeTracks->Branch("pdg"      , &mTracks.pdg      , "pdg[n]/I");
-  mTreeTracks->Branch("vt"       , &mTracks.vt       , "vt[n]/D");
-  mTreeTracks->Branch("vx"       , &mTracks.vx       , "vx[n]/D");
-  mTreeTracks->Branch("vy"       , &mTracks.vy       , "vy[n]/D");
-  mTreeTracks->Branch("vz"       , &mTracks.vz       , "vz[n]/D");
-  mTreeTracks->Branch("e"        , &mTracks.e        , "e[n]/D");
-  mTreeTracks->Branch("px"       , &mTracks.px       , "px[n]/D");
-  mTreeTracks->Branch("py"       , &mTracks.py       , "py[n]/D");
-  mTreeTracks->Branch("pz"       , &mTracks.pz       , "pz[n]/D");
-
-  if (mSaveParticles) {
-    mTreeParticles = new TTree("Particles", "RootIO tree");
-    mTreeParticles->Branch("n"      , &mParticles.n      , "n/I");
-    mTreeParticles->Branch("parent" , &mParticles.parent , "parent[n]/I");
-    mTreeParticles->Branch("pdg"    , &mParticles.pdg    , "pdg[n]/I");
-    mTreeParticles->Branch("vt"     , &mParticles.vt     , "vt[n]/D");
-    mTreeParticles->Branch("vx"     , &mParticles.vx     , "vx[n]/D");
-    mTreeParticles->Branch("vy"     , &mParticles.vy     , "vy[n]/D");
-    mTreeParticles->Branch("vz"     , &mParticles.vz     , "vz[n]/D");
-    mTreeParticles->Branch("e"      , &mParticles.e      , "e[n]/D");
-    mTreeParticles->Branch("px"     , &mParticles.px     , "px[n]/D");
-    mTreeParticles->Branch("py"     , &mParticles.py     , "py[n]/D");
-    mTreeParticles->Branch("pz"     , &mParticles.pz     , "pz[n]/D");
+  for (int collection = 0; collection < kNCollections; ++collection) {
+    mTree[collection] = nullptr;
+    if (!IsSaved(collection)) continue;
+    auto tree = mTree[collection] = new TTree(kTreeName[collection], "RootIO tree");
+    tree->Branch("n", GetSize(collection), "n/I");
+    for (const auto &column : mSchema[collection])
+      if (column.enabled)
+	tree->Branch(column.name.c_str(), column.data, Form("%s[n]/%c", column.name.c_str(), column.leaf));
   }
+
+  mTreeEvents = new TTree("Events", "RootIO tree");
+  for (const auto &column : mEventSchema)
+    if (column.enabled)
+      mTreeEvents->Branch(column.name.c_str(), column.data, Form("%s/%c", column.name.c_str(), column.leaf));
+
+  auto &stats = EventStats::Instance()->GetData();
+  mTreeEventStats = new TTree("EventStats", "RootIO tree");
+  mTreeEventStats->Branch("tgen"       , &stats.time[EventStats::kGeneration] , "tgen/F");
+  mTreeEventStats->Branch("tdec"       , &stats.time[EventStats::kDecay]      , "tdec/F");
+  mTreeEventStats->Branch("ttrk"       , &stats.time[EventStats::kTransport]  , "ttrk/F");
+  mTreeEventStats->Branch("tout"       , &stats.time[EventStats::kOutput]     , "tout/F");
+  mTreeEventStats->Branch("ntracks"    , &stats.ntracks                       , "ntracks/I");
+  mTreeEventStats->Branch("nhits"      , &stats.nhits                         , "nhits/I");
+  mTreeEventStats->Branch("nparticles" , &stats.nparticles                    , "nparticles/I");
+  mTreeEventStats->Branch("rss"        , &stats.rss                           , "rss/F");
     
 };
 
@@ -147,11 +395,68 @@ RootIO::Open(std::string filename) {
 void
 RootIO::Close()
 {
+  if (mFlat) {
+    mFlat->Close();
+    mChunks.back().bytes = mFlat->GetBytes();
+    delete mFlat;
+    mFlat = nullptr;
+    return;
+  }
+
   mFile->cd();
-  mTreeHits->Write();
-  mTreeTracks->Write();
-  if (mSaveParticles) mTreeParticles->Write();
+  for (auto tree : mTree)
+    if (tree) tree->Write();
+  if (mTreeEvents->GetBranch("run") && mTreeEvents->GetBranch("event")) mTreeEvents->BuildIndex("run", "event");
+  mTreeEvents->Write();
+  mTreeEventStats->Write();
   mFile->Close();
+  mChunks.back().bytes = mFile->GetEND();
+  delete mFile;
+  mFile = nullptr;
+  for (auto &tree : mTree) tree = nullptr;
+  mTreeEvents = nullptr;
+  mTreeEventStats = nullptr;
+}
+
+/*****************************************************************/
+
+bool
+RootIO::WriteManifest(const std::string &filename, int runID, const std::vector<Chunk_t> &chunks)
+{
+  /** one file per line, as read back by ReadManifest **/
+  std::ofstream fout(filename);
+  if (!fout.is_open()) return false;
+  fout << "{" << std::endl
+       << "  \"run\": " << runID << "," << std::endl
+       << "  \"files\": [";
+  for (int i = 0; i < chunks.size(); ++i)
+    fout << (i ? "," : "") << std::endl
+	 << "    {\"file\": \"" << chunks[i].file << "\", \"first\": " << chunks[i].first
+	 << ", \"last\": " << chunks[i].last << ", \"events\": " << chunks[i].events
+	 << ", \"bytes\": " << chunks[i].bytes << "}";
+  fout << std::endl << "  ]" << std::endl << "}" << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+RootIO::ReadManifest(const std::string &filename, std::vector<Chunk_t> &chunks)
+{
+  std::ifstream fin(filename);
+  if (!fin.is_open()) return false;
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.find("{\"file\"") == std::string::npos) continue;
+    for (auto &c : line) if (c == '"' || c == ',' || c == '{' || c == '}' || c == ':') c = ' ';
+    Chunk_t chunk;
+    std::string key;
+    std::istringstream iss(line);
+    iss >> key >> chunk.file >> key >> chunk.first >> key >> chunk.last >> key >> chunk.events >> key >> chunk.bytes;
+    if (iss.fail()) return false;
+    chunks.push_back(chunk);
+  }
+  return true;
 }
 
 /*****************************************************************/
@@ -167,7 +472,7 @@ RootIO::ResetTracks()
 void
 RootIO::FillTracks()
 {
-  mTreeTracks->Fill();
+  mTree[kTracks]->Fill();
 }
 
 /*****************************************************************/
@@ -203,7 +508,7 @@ RootIO::AddTrack(const G4Track *aTrack) {
 /*****************************************************************/
 
 void
-RootIO::AddStatus(const G4Track *aTrack, ETrackStatus_t status) {
+RootIO::AddStatus(const G4Track *aTrack, int status) {
   auto id = aTrack->GetTrackID() - 1;
   mTracks.status[id] |= status;
 }
@@ -221,13 +526,13 @@ RootIO::ResetHits()
 void
 RootIO::FillHits()
 {
-  mTreeHits->Fill();
+  mTree[kHits]->Fill();
 }
 
 /*****************************************************************/
 
 void
-RootIO::AddHit(const G4Step *aStep)
+RootIO::AddHit(const G4Step *aStep, unsigned long long segid)
 {
   auto point = aStep->GetPreStepPoint();
   auto track = aStep->GetTrack();
@@ -239,6 +544,7 @@ RootIO::AddHit(const G4Step *aStep)
   mHits.z[mHits.n]      = track->GetPosition().z() / cm;
   mHits.t[mHits.n]      = track->GetGlobalTime()   / ns;
   mHits.lyrid[mHits.n]  = point->GetTouchableHandle()->GetCopyNumber();
+  mHits.segid[mHits.n]  = segid;
   mHits.n++;
 }
 
@@ -257,7 +563,7 @@ void
 RootIO::FillParticles()
 {
   if (!mSaveParticles) return;
-  mTreeParticles->Fill();
+  mTree[kParticles]->Fill();
 }
 
 /*****************************************************************/
@@ -276,7 +582,7 @@ RootIO::AddParticle(int id, int pdg, int parent,
   mParticles.pdg[id]    = pdg;
   mParticles.vt[id]     = vt;
   mParticles.vx[id]     = vx;
-  mParticles.vy[id]     = vx;
+  mParticles.vy[id]     = vy;
   mParticles.vz[id]     = vz;
   mParticles.e[id]      = et;
   mParticles.px[id]     = px;
@@ -287,4 +593,85 @@ RootIO::AddParticle(int id, int pdg, int parent,
 
 /*****************************************************************/
 
+void
+RootIO::StreamEvent(const G4Event *aEvent)
+{
+  if (!mStream) return;
+
+  /** the layout is described in StreamFrame.hh, the columns in RootIOSchema.hh **/
+  mFrame.resize(sizeof(Stream::Header_t));
+  auto put = [this](const void *data, size_t size) {
+    auto offset = mFrame.size();
+    mFrame.resize(offset + size);
+    std::memcpy(mFrame.data() + offset, data, size);
+  };
+  int64_t event = aEvent->GetEventID();
+  put(&event, sizeof(event));
+
+  /** all the columns are sent, also the disabled ones **/
+  for (const auto &column : mEventSchema)
+    put(column.data, column.size);
+  for (int collection = 0; collection < kNCollections; ++collection) {
+    int n = IsSaved(collection) ? *GetSize(collection) : 0;
+    put(&n, sizeof(n));
+    for (const auto &column : mSchema[collection])
+      put(column.data, n * column.size);
+  }
+
+  Stream::Header_t header = {Stream::kMagic, Stream::kVersion, mFrame.size() - sizeof(Stream::Header_t)};
+  std::memcpy(mFrame.data(), &header, sizeof(header));
+
+  /** the frame is handed over to the writer thread, the next one starts at the same size **/
+  auto capacity = mFrame.capacity();
+  if (!mStream->Push(std::move(mFrame))) {
+    std::cout << " --- stream: events are dropped" << std::endl;
+    mStream->Close();
+    delete mStream;
+    mStream = nullptr;
+  }
+  mFrame.clear();
+  mFrame.reserve(capacity);
+}
+
+/*****************************************************************/
+
+void
+RootIO::OpenFlat(const std::string &filename)
+{
+  mFlat = new FlatWriter;
+  mFlat->Open(filename);
+  for (int collection = 0; collection < kNCollections; ++collection) {
+    mFlatColumns[collection].clear();
+    if (!IsSaved(collection)) continue;
+    mFlatCollection[collection] = mFlat->Collection(kCollectionName[collection]);
+    for (const auto &column : mSchema[collection])
+      if (column.enabled)
+	mFlatColumns[collection].push_back({mFlat->Column(mFlatCollection[collection], column.name, Flat::Type(column.leaf)), column.data});
+  }
+
+  /** the event number is already in the "event" column **/
+  mFlatEventColumns.clear();
+  for (const auto &column : mEventSchema)
+    mFlatEventColumns.push_back(column.enabled && column.name != "event" ? mFlat->Column("events." + column.name, Flat::Type(column.leaf)) : -1);
+}
+
+/*****************************************************************/
+
+void
+RootIO::FillFlat(const G4Event *aEvent)
+{
+  for (int collection = 0; collection < kNCollections; ++collection) {
+    if (!IsSaved(collection)) continue;
+    auto n = *GetSize(collection);
+    for (const auto &column : mFlatColumns[collection])
+      mFlat->Fill(column.id, column.data, n);
+    mFlat->Next(mFlatCollection[collection], n);
+  }
+  for (int i = 0; i < mEventSchema.size(); ++i)
+    if (mFlatEventColumns[i] >= 0) mFlat->Fill(mFlatEventColumns[i], mEventSchema[i].data, 1);
+  mFlat->EndOfEvent(aEvent->GetEventID());
+}
+
+/*****************************************************************/
+
 } /** namespace G4me **/
@@ -5,11 +5,16 @@
 #define _RootIO_h_
 
 #include "G4UImessenger.hh"
+#include <string>
+#include <vector>
+#include "RootIOSchema.hh"
 
 class G4UIcommand;
 class G4UIdirectory;
 class G4UIcmdWithAString;
 class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWithADouble;
 class G4Event;
 class G4Run;
 class G4Track;
@@ -19,6 +24,9 @@ class TTree;
 
 namespace G4me {
 
+class StreamWriter;
+class FlatWriter;
+
 class RootIO : public G4UImessenger
 {
   
@@ -40,97 +48,166 @@ public:
   void Open(std::string filename);
   void Close();
 
+  TFile *GetFile() const { return mFile; };
+  const std::string &GetFilePrefix() const { return mFilePrefix; };
+  void SetFileSuffix(const std::string &suffix) { mFileSuffix = suffix; };
+  const std::string &GetFileSuffix() const { return mFileSuffix; };
+
+  /** output file rotation, one entry per file in the manifest **/
+  struct Chunk_t {
+    std::string file;
+    long first;
+    long last;
+    long events;
+    long bytes;
+  };
+  
+  bool IsRotating() const { return !IsStreaming() && (mMaxEvents > 0 || mMaxBytes > 0.); };
+  bool IsStreaming() const { return !mStreamPath.empty(); };
+  bool IsFlat() const { return mFlatFormat; };
+  std::string GetFileName(int runID, int chunk) const;
+  static bool WriteManifest(const std::string &filename, int runID, const std::vector<Chunk_t> &chunks);
+  static bool ReadManifest(const std::string &filename, std::vector<Chunk_t> &chunks);
+
   enum ETrackStatus_t {
     kTransport = 1 << 0,
     kElectromagnetic = 1 << 1,
     kHadronic = 1 << 2,
     kDecay = 1 << 3,
     kConversion = 1 << 4,
-    kCompton = 1 << 5
+    kCompton = 1 << 5,
+    kUserLimit = 1 << 6
   };
   
   void ResetTracks();
   void FillTracks();
   void AddTrack(const G4Track *aTrack);
-  void AddStatus(const G4Track *aTrack, ETrackStatus_t status);
+  void AddStatus(const G4Track *aTrack, int status);
   
   void ResetHits();
   void FillHits();
-  void AddHit(const G4Step *aStep);
+  void AddHit(const G4Step *aStep, unsigned long long segid = 0);
 
   void ResetParticles();
   void FillParticles();
   void AddParticle(int id, int pdg, int parent,
 		   double px, double py, double pz, double et,
 		   double vx, double vy, double vz, double vt);
+
+  void StreamEvent(const G4Event *aEvent);
+  void ComputeIndices();
+
+  /** per-event header, the generator fills its part **/
+  struct Events_t {
+    G4ME_EVENTS_SCHEMA(G4ME_SCHEMA_SCALAR)
+  };
+  Events_t &GetEventHeader() { return mEventHeader; };
+  void ResetEventHeader();
+
+  void OpenFlat(const std::string &filename);
+  void FillFlat(const G4Event *aEvent);
   
   private:
 
-  RootIO() = default;
+  RootIO() { InitSchema(); };
   
   static RootIO *mInstance;
   std::string mFilePrefix = "tracker";
+  std::string mFileSuffix;
   TFile *mFile = nullptr;
-  TTree *mTreeHits = nullptr;
-  TTree *mTreeTracks = nullptr;
-  TTree *mTreeParticles = nullptr;
+  TTree *mTree[3] = {nullptr, nullptr, nullptr}; // hits, tracks, particles
+  TTree *mTreeEventStats = nullptr;
+  TTree *mTreeEvents = nullptr;
 
   G4UIdirectory *mDirectory;
   G4UIcmdWithAString *mFileNameCmd;
   G4UIcmdWithABool *mSaveParticlesCmd;
+  G4UIcmdWithAnInteger *mMaxEventsCmd;
+  G4UIcmdWithADouble *mMaxBytesCmd;
+  G4UIcmdWithAString *mStreamCmd;
+  G4UIcmdWithAnInteger *mStreamDepthCmd;
+  G4UIcmdWithAString *mFormatCmd;
+  G4UIcommand *mBranchesCmd;
 
   bool mSaveParticles = true;
+
+  long mMaxEvents = 0;       // events per file, 0 for no limit
+  double mMaxBytes = 0.;     // bytes per file, 0 for no limit
+  int mRunID = 0;
+  bool mRotate = false;      // open a new file before the next event
+  std::vector<Chunk_t> mChunks;
+
+  std::string mStreamPath;   // named pipe or Unix socket, no file is written
+  int mStreamDepth = 16;     // frames buffered before the simulation waits
+  StreamWriter *mStream = nullptr;
+  std::vector<char> mFrame;
+
+  bool mFlatFormat = false;  // flat columnar files instead of ROOT, see FlatFormat.hh
+  FlatWriter *mFlat = nullptr;
+  struct FlatColumn_t {
+    int id;
+    const void *data;
+  };
+  int mFlatCollection[3];    // hits, tracks, particles
+  std::vector<FlatColumn_t> mFlatColumns[3];
+
+  static const char *kCollectionName[3];
+  static const char *kTreeName[3];
   
+  /** buffers expanded from the schema, see RootIOSchema.hh **/
+
   static const int kMaxHits = 1048576;
   
   struct Hits_t {
-    int    n;
-    int    trkid[kMaxHits];
-    float  trklen[kMaxHits];
-    float  edep[kMaxHits];
-    float  x[kMaxHits];
-    float  y[kMaxHits];
-    float  z[kMaxHits];
-    float  t[kMaxHits];
-    int    lyrid[kMaxHits];
+    static const int kMax = kMaxHits;
+    int n;
+    G4ME_HITS_SCHEMA(G4ME_SCHEMA_ARRAY)
   } mHits; //!
 
   static const int kMaxTracks = 1048576;
 
   struct Tracks_t {
-    int    n;
-    char   proc[kMaxTracks]; // creator process type 
-    char   sproc[kMaxTracks]; // creator process subtype
-    int    status[kMaxTracks];
-    int    parent[kMaxTracks];
-    int    particle[kMaxTracks];
-    int    pdg[kMaxTracks];
-    double vt[kMaxTracks];
-    double vx[kMaxTracks];
-    double vy[kMaxTracks];
-    double vz[kMaxTracks];
-    double  e[kMaxTracks];
-    double px[kMaxTracks];
-    double py[kMaxTracks];
-    double pz[kMaxTracks];
+    static const int kMax = kMaxTracks;
+    int n;
+    G4ME_TRACKS_SCHEMA(G4ME_SCHEMA_ARRAY)
   } mTracks; //!
   
   static const int kMaxParticles = 1048576;
 
   struct Particles_t {
-    int    n;
-    int    parent[kMaxParticles];
-    int    pdg[kMaxParticles];
-    double vt[kMaxParticles];
-    double vx[kMaxParticles];
-    double vy[kMaxParticles];
-    double vz[kMaxParticles];
-    double  e[kMaxParticles];
-    double px[kMaxParticles];
-    double py[kMaxParticles];
-    double pz[kMaxParticles];
+    static const int kMax = kMaxParticles;
+    int n;
+    G4ME_PARTICLES_SCHEMA(G4ME_SCHEMA_ARRAY)
   } mParticles; //!
 
+  /** the columns of each collection, with their enable flag **/
+  enum ECollection_t {
+    kHits,
+    kTracks,
+    kParticles,
+    kNCollections
+  };
+
+  struct Column_t {
+    std::string name;
+    char leaf;
+    void *data;
+    size_t size;
+    bool enabled;
+  };
+
+  void InitSchema();
+  int *GetSize(int collection);
+  bool IsSaved(int collection) const { return collection != kParticles || mSaveParticles; };
+  
+  std::vector<Column_t> mSchema[kNCollections];
+  std::vector<Column_t> mEventSchema;
+  Events_t mEventHeader;
+  std::vector<int> mFlatEventColumns;
+  std::vector<int> mHitOrder;      // for the grouping of the hits by track
+  std::vector<int> mHitCursor;
+  std::vector<char> mHitBuffer;
+
 };
 
 } /** namespace G4me **/
@@ -0,0 +1,91 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _RootIOSchema_h_
+#define _RootIOSchema_h_
+
+/** the output schema, one X(type, name, leaf) entry per column of
+    each collection, where leaf is the ROOT leaf type code. every
+    collection also has its size n. the RootIO buffers and branches,
+    the flat and stream writers, the stream client and the io.C
+    reader are all expanded from these lists: a column is added
+    or changed here only. the order is the order of the columns
+    in the stream frames **/
+
+#define G4ME_HITS_SCHEMA(X)				\
+  X(int,                trkid,    I)			\
+  X(float,              trklen,   F)			\
+  X(float,              edep,     F)			\
+  X(float,              x,        F)			\
+  X(float,              y,        F)			\
+  X(float,              z,        F)			\
+  X(float,              t,        F)			\
+  X(int,                lyrid,    I)			\
+  X(unsigned long long, segid,    l) /* packed readout id, see Segmentation */
+
+#define G4ME_TRACKS_SCHEMA(X)				\
+  X(char,               proc,     B) /* creator process type */		\
+  X(char,               sproc,    B) /* creator process subtype */	\
+  X(int,                status,   I)			\
+  X(int,                parent,   I)			\
+  X(int,                particle, I)			\
+  X(int,                pdg,      I)			\
+  X(double,             vt,       D)			\
+  X(double,             vx,       D)			\
+  X(double,             vy,       D)			\
+  X(double,             vz,       D)			\
+  X(double,             e,        D)			\
+  X(double,             px,       D)			\
+  X(double,             py,       D)			\
+  X(double,             pz,       D)			\
+  X(int,                ancestor, I) /* primary track it descends from */	\
+  X(int,                depth,    I) /* generation, 0 for primaries */	\
+  X(int,                hit0,     I) /* first hit, -1 if none */	\
+  X(int,                nhits,    I) /* hits from hit0 on */
+
+#define G4ME_PARTICLES_SCHEMA(X)			\
+  X(int,                parent,   I)			\
+  X(int,                pdg,      I)			\
+  X(double,             vt,       D)			\
+  X(double,             vx,       D)			\
+  X(double,             vy,       D)			\
+  X(double,             vz,       D)			\
+  X(double,             e,        D)			\
+  X(double,             px,       D)			\
+  X(double,             py,       D)			\
+  X(double,             pz,       D)			\
+  X(int,                track,    I) /* track injected from it, -1 if none */
+
+/** one entry per event in the Events tree, scalar columns **/
+
+#define G4ME_EVENTS_SCHEMA(X)				\
+  X(int,                event,      I)			\
+  X(int,                run,        I)			\
+  X(int,                process,    I) /* generator process code, -1 if none */	\
+  X(double,             weight,     D) /* generator weight */	\
+  X(float,              b,          F) /* impact parameter in fm, -1 if none */	\
+  X(int,                npart,      I) /* participants, -1 if none */	\
+  X(int,                ncoll,      I) /* binary collisions, -1 if none */	\
+  X(int,                mult,       I) /* generator final-state particles */	\
+  X(int,                ntracks,    I)			\
+  X(int,                nhits,      I)			\
+  X(int,                nparticles, I)			\
+  X(long long,          seed0,      L) /* random seeds */	\
+  X(long long,          seed1,      L)			\
+  X(long long,          master,     L) /* master seed, 0 without per-event seeds */	\
+  X(long long,          hepmc,      L) /* event in the HepMC file, -1 if none */
+
+/** X(collection, tree name, schema) for each collection **/
+
+#define G4ME_COLLECTIONS(X)				\
+  X(hits,      Hits,      G4ME_HITS_SCHEMA)		\
+  X(tracks,    Tracks,    G4ME_TRACKS_SCHEMA)		\
+  X(particles, Particles, G4ME_PARTICLES_SCHEMA)
+
+/** helpers for the common expansions **/
+
+#define G4ME_SCHEMA_SCALAR(type, name, leaf) type name;
+#define G4ME_SCHEMA_ARRAY(type, name, leaf) type name[kMax];
+#define G4ME_SCHEMA_VECTOR(type, name, leaf) std::vector<type> name;
+
+#endif /** _RootIOSchema_h_ **/
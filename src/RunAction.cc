@@ -5,6 +5,12 @@
 #include "G4Run.hh"
 
 #include "RootIO.hh"
+#include "AcceptanceFilter.hh"
+#include "TrackingLimits.hh"
+#include "Profiler.hh"
+#include "EventStats.hh"
+#include "Segmentation.hh"
+#include "Random.hh"
 
 namespace G4me {
 
@@ -16,7 +22,13 @@ RunAction::BeginOfRunAction(const G4Run *aRun)
   /** begin of run action **/
 
   std::cout << "--- start of run: " << aRun->GetRunID() << std::endl;  
+  Random::Instance()->BeginOfRunAction(aRun);
   RootIO::Instance()->BeginOfRunAction(aRun);
+  AcceptanceFilter::Instance()->BeginOfRunAction(aRun);
+  TrackingLimits::Instance()->BeginOfRunAction(aRun);
+  Profiler::Instance()->BeginOfRunAction(aRun);
+  EventStats::Instance()->BeginOfRunAction(aRun);
+  Segmentation::Instance()->BeginOfRunAction(aRun);
 
 }
 
@@ -28,7 +40,11 @@ RunAction::EndOfRunAction(const G4Run *aRun)
   /** end of run action **/
 
   std::cout << "--- end of run: " << aRun->GetRunID() << std::endl;
-  RootIO::Instance()->Close();
+  AcceptanceFilter::Instance()->EndOfRunAction(aRun);
+  TrackingLimits::Instance()->EndOfRunAction(aRun);
+  Profiler::Instance()->EndOfRunAction(aRun);
+  EventStats::Instance()->EndOfRunAction(aRun);
+  RootIO::Instance()->EndOfRunAction(aRun);
 }
 
 /******************************************************************************/
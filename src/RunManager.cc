@@ -0,0 +1,211 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "RunManager.hh"
+#include "RootIO.hh"
+#include "Pythia8.hh"
+#include "Random.hh"
+#include "G4RunManagerKernel.hh"
+#include "G4UImanager.hh"
+#include "G4UIcommandTree.hh"
+#include "Randomize.hh"
+#include "TFileMerger.h"
+#include "TString.h"
+#include <vector>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace G4me {
+
+/*****************************************************************/
+
+void
+RunManager::BeamOn(G4int n_event, const char *macroFile, G4int n_select)
+{
+  /** a single consumer cannot take interleaved streams **/
+  if (mJobs > 1 && RootIO::Instance()->IsStreaming())
+    std::cout << " --- streaming output: running in a single process" << std::endl;
+  if (mJobs <= 1 || n_event < mJobs || RootIO::Instance()->IsStreaming()) {
+    G4RunManager::BeamOn(n_event, macroFile, n_select);
+    return;
+  }
+  BeamOnForked(n_event, macroFile, n_select);
+}
+
+/*****************************************************************/
+
+G4Event *
+RunManager::GenerateEvent(G4int i_event)
+{
+  /** event numbers are global across the workers **/
+  Random::Instance()->SeedEvent(currentRun->GetRunID(), i_event + mEventOffset);
+  return G4RunManager::GenerateEvent(i_event + mEventOffset);
+}
+
+/*****************************************************************/
+
+void
+RunManager::Resimulate(int runID, int eventID, int n_event, long hepmc)
+{
+  /** a single process, with the run and event numbers of the original
+      run and a distinct output file. the HepMC reader goes to the event
+      of the file recorded in Events.hepmc, counted from its start **/
+  auto io = RootIO::Instance();
+  auto ui = G4UImanager::GetUIpointer();
+  if (ui->GetTree()->FindPath("/hepmc/seek")) {
+    /** without the recorded position only the first run is known to
+        start at the beginning of the file, if nothing was skipped **/
+    if (hepmc < 0 && runID > 0) {
+      std::cout << " --- run " << runID << ": HepMC input, give the position in the file from Events.hepmc" << std::endl;
+      return;
+    }
+    ui->ApplyCommand(Form("/hepmc/seek %ld", hepmc < 0 ? (long)eventID : hepmc));
+  }
+  auto counter = runIDCounter;
+  auto suffix = io->GetFileSuffix();
+  std::cout << " --- run " << runID << ": resimulating " << n_event << " events from event " << eventID << std::endl;
+  io->SetFileSuffix(suffix + Form(".ev%06d", eventID));
+  runIDCounter = runID;
+  mEventOffset = eventID;
+  G4RunManager::BeamOn(n_event);
+  mEventOffset = 0;
+  runIDCounter = counter;
+  io->SetFileSuffix(suffix);
+}
+
+/*****************************************************************/
+
+void
+RunManager::BeamOnForked(G4int n_event, const char *macroFile, G4int n_select)
+{
+  if (!ConfirmBeamOnCondition()) return;
+  
+  /** geometry closing and physics tables are done once, here **/
+  kernel->RunInitialization();
+  kernel->RunTermination();
+
+  /** the master seed of the per-event seeds is drawn before forking **/
+  if (Random::Instance()->IsPerEvent()) Random::Instance()->GetMasterSeed();
+
+  /** the seeds of the workers are drawn from the master engine,
+      so that they follow /random/setSeeds and change at every run **/
+  std::vector<std::pair<long, long>> seeds;
+  for (int job = 0; job < mJobs; ++job)
+    seeds.push_back({(long)(CLHEP::HepRandom::getTheEngine()->flat() * 900000000.) + 1,
+		     (long)(CLHEP::HepRandom::getTheEngine()->flat() * 900000000.) + 1});
+
+  auto runID = runIDCounter;
+  auto io = RootIO::Instance();
+  std::cout << " --- run " << runID << ": " << n_event << " events in " << mJobs << " jobs" << std::endl;
+  std::cout.flush();
+
+  std::vector<pid_t> pids;
+  std::vector<std::string> files;
+  for (int job = 0; job < mJobs; ++job) {
+    int first = (long)n_event * job / mJobs;
+    int last = (long)n_event * (job + 1) / mJobs;
+    auto suffix = std::string(Form(".job%03d", job));
+    files.push_back(Form("%s.%03d%s.root", io->GetFilePrefix().c_str(), runID, suffix.c_str()));
+
+    auto pid = fork();
+    if (pid < 0) {
+      std::cout << " --- run " << runID << ": fork failed for job " << job << std::endl;
+      break;
+    }
+    if (pid > 0) {
+      pids.push_back(pid);
+      continue;
+    }
+
+    /** worker **/
+    long workerSeeds[3] = {seeds[job].first, seeds[job].second, 0};
+    CLHEP::HepRandom::setTheSeeds(workerSeeds);
+    Pythia8::Reseed(workerSeeds[0] % 900000000);
+    if (first > 0) SkipHepMC(first);
+    io->SetFileSuffix(suffix);
+    mEventOffset = first;
+    G4RunManager::BeamOn(last - first, macroFile, n_select);
+    std::cout.flush();
+    _exit(0);
+  }
+
+  /** wait for the workers **/
+  bool ok = pids.size() == mJobs;
+  for (auto pid : pids) {
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cout << " --- run " << runID << ": worker " << pid << " failed" << std::endl;
+      ok = false;
+    }
+  }
+
+  /** the master does not simulate, keep the run numbering as in a normal run
+      and the HepMC reader where a single process would have left it **/
+  runIDCounter++;
+  SkipHepMC(n_event);
+  
+  if (!ok) {
+    std::cout << " --- run " << runID << ": job outputs are not merged" << std::endl;
+    return;
+  }
+
+  /** rotated outputs are not merged, the job manifests are combined **/
+  if (io->IsRotating()) {
+    std::vector<RootIO::Chunk_t> chunks;
+    for (int job = 0; job < mJobs; ++job) {
+      auto manifest = std::string(Form("%s.%03d.job%03d.json", io->GetFilePrefix().c_str(), runID, job));
+      if (!RootIO::ReadManifest(manifest, chunks)) {
+	std::cout << " --- run " << runID << ": cannot read " << manifest << std::endl;
+	return;
+      }
+      std::remove(manifest.c_str());
+    }
+    auto manifest = std::string(Form("%s.%03d.json", io->GetFilePrefix().c_str(), runID));
+    RootIO::WriteManifest(manifest, runID, chunks);
+    std::cout << " --- run " << runID << ": " << chunks.size() << " output files, see " << manifest << std::endl;
+    return;
+  }
+  
+  if (io->IsFlat()) {
+    std::cout << " --- run " << runID << ": flat outputs are not merged, "
+	      << Form("%s.%03d.job*.g4f", io->GetFilePrefix().c_str(), runID) << std::endl;
+    return;
+  }
+  
+  auto output = std::string(Form("%s.%03d.root", io->GetFilePrefix().c_str(), runID));
+  if (Merge(output, files))
+    for (const auto &file : files) std::remove(file.c_str());
+}
+
+/*****************************************************************/
+
+void
+RunManager::SkipHepMC(int n_event) const
+{
+  /** the command exists only when the HepMC generator is selected **/
+  auto ui = G4UImanager::GetUIpointer();
+  if (n_event > 0 && ui->GetTree()->FindPath("/hepmc/skip"))
+    ui->ApplyCommand(Form("/hepmc/skip %d", n_event));
+}
+
+/*****************************************************************/
+
+bool
+RunManager::Merge(const std::string &output, const std::vector<std::string> &inputs) const
+{
+  TFileMerger merger(false, false);
+  merger.SetPrintLevel(0);
+  if (!merger.OutputFile(output.c_str(), "RECREATE")) return false;
+  for (const auto &input : inputs)
+    if (!merger.AddFile(input.c_str(), false)) return false;
+  auto ok = merger.Merge();
+  std::cout << " --- merged " << inputs.size() << " job outputs into " << output
+	    << (ok ? "" : " FAILED") << std::endl;
+  return ok;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
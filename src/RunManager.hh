@@ -0,0 +1,46 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _RunManager_h_
+#define _RunManager_h_
+
+#include "G4RunManager.hh"
+#include <string>
+
+namespace G4me {
+
+/** sequential run manager that can split a run among forked
+    workers, which inherit geometry, physics tables and generator
+    initialisation copy-on-write. each worker simulates a disjoint
+    event range with its own seeds and output file, the outputs
+    are merged at the end of the run **/
+  
+class RunManager : public G4RunManager
+{
+
+public:
+
+  RunManager() = default;
+  ~RunManager() override = default;
+
+  void BeamOn(G4int n_event, const char *macroFile = 0, G4int n_select = -1) override;
+  G4Event *GenerateEvent(G4int i_event) override;
+  void Resimulate(int runID, int eventID, int n_event, long hepmc = -1);
+
+  void SetJobs(int jobs) { mJobs = jobs; };
+  int GetJobs() const { return mJobs; };
+  
+protected:
+
+  void BeamOnForked(G4int n_event, const char *macroFile, G4int n_select);
+  bool Merge(const std::string &output, const std::vector<std::string> &inputs) const;
+  void SkipHepMC(int n_event) const;
+  
+  int mJobs = 1;
+  int mEventOffset = 0;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _RunManager_h_ **/
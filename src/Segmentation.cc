@@ -0,0 +1,126 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "Segmentation.hh"
+#include "DetectorConstruction.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4StepPoint.hh"
+#include "G4UIcommand.hh"
+#include <cmath>
+
+namespace G4me {
+
+Segmentation *Segmentation::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+Segmentation::InitMessenger()
+{
+  /** the /detector/tracker/ directory belongs to the detector construction **/
+  mSegmentationCmd = new G4UIcommand("/detector/tracker/segmentation", this);
+  mSegmentationCmd->SetGuidance("Readout segmentation of a tracker layer, -1 for all layers.");
+  mSegmentationCmd->SetGuidance("  staves : number of staves in phi");
+  mSegmentationCmd->SetGuidance("  moduleLength : length of a module along z");
+  mSegmentationCmd->SetGuidance("  pitchRPhi pitchZ : pixel size");
+  mSegmentationCmd->SetParameter(new G4UIparameter("layer", 'i', false));
+  auto parameter = new G4UIparameter("staves", 'i', false);
+  parameter->SetParameterRange("staves > 0 && staves < 4096");
+  mSegmentationCmd->SetParameter(parameter);
+  mSegmentationCmd->SetParameter(new G4UIparameter("moduleLength", 'd', false));
+  mSegmentationCmd->SetParameter(new G4UIparameter("pitchRPhi", 'd', false));
+  mSegmentationCmd->SetParameter(new G4UIparameter("pitchZ", 'd', false));
+  mSegmentationCmd->SetParameter(new G4UIparameter("unit", 's', false));
+  mSegmentationCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+Segmentation::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mSegmentationCmd) {
+    G4String module_value, rphi_value, z_value, unit;
+    int layer, staves;
+    std::istringstream iss(value);
+    iss >> layer >> staves >> module_value >> rphi_value >> z_value >> unit;
+    auto &settings = mSettings[layer];
+    settings["staves"] = staves;
+    settings["moduleLength"] = command->ConvertToDimensionedDouble(G4String(module_value + ' ' + unit));
+    settings["pitchRPhi"] = command->ConvertToDimensionedDouble(G4String(rphi_value + ' ' + unit));
+    settings["pitchZ"] = command->ConvertToDimensionedDouble(G4String(z_value + ' ' + unit));
+  }
+}
+
+/*****************************************************************/
+
+void
+Segmentation::BeginOfRunAction(const G4Run *aRun)
+{
+  mLayers.clear();
+  if (mSettings.empty()) return;
+  
+  auto detector = dynamic_cast<const DetectorConstruction *>(G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if (!detector) return;
+  auto layers = detector->GetTrackerLayers();
+  mLayers.resize(layers.size());
+  
+  for (int ilayer = 0; ilayer < layers.size(); ++ilayer) {
+    auto it = mSettings.count(ilayer) ? mSettings.find(ilayer) : mSettings.find(-1);
+    if (it == mSettings.end()) continue;
+    auto settings = it->second;
+    auto &layer = mLayers[ilayer];
+    layer.segmented = true;
+    layer.staves = settings["staves"];
+    layer.dphi = 2. * M_PI / layer.staves;
+    layer.radius = layers[ilayer]["radius"];
+    layer.halfLength = layers[ilayer]["length"];
+    layer.moduleLength = settings["moduleLength"];
+    layer.pitchRPhi = settings["pitchRPhi"];
+    layer.pitchZ = settings["pitchZ"];
+
+    /** check that the indices fit in the packed id **/
+    auto modules = std::ceil(2. * layer.halfLength / layer.moduleLength);
+    auto pixelsRPhi = std::ceil(layer.radius * layer.dphi / layer.pitchRPhi);
+    auto pixelsZ = std::ceil(layer.moduleLength / layer.pitchZ);
+    std::cout << " --- segmentation: layer " << ilayer << ", "
+	      << layer.staves << " staves x " << modules << " modules x "
+	      << pixelsRPhi << " x " << pixelsZ << " pixels" << std::endl;
+    if (ilayer > 0x7f || modules > 0xfff || pixelsRPhi > 0xffff || pixelsZ > 0xffff)
+      std::cout << " --- segmentation: layer " << ilayer << " exceeds the packed id range, ids will wrap" << std::endl;
+  }
+}
+
+/*****************************************************************/
+
+unsigned long long
+Segmentation::GetID(const G4Step *aStep) const
+{
+  auto ilayer = aStep->GetPreStepPoint()->GetTouchableHandle()->GetCopyNumber();
+  if (ilayer < 0 || ilayer >= mLayers.size() || !mLayers[ilayer].segmented) return 0;
+  auto &layer = mLayers[ilayer];
+
+  /** the layers are not rotated nor translated, the hit position
+      is the same that is written in the Hits tree **/
+  auto position = aStep->GetTrack()->GetPosition();
+  auto phi = std::atan2(position.y(), position.x());
+  if (phi < 0.) phi += 2. * M_PI;
+  int stave = phi / layer.dphi;
+  if (stave >= layer.staves) stave = layer.staves - 1;
+  int u = (phi - stave * layer.dphi) * layer.radius / layer.pitchRPhi;
+  
+  auto z = position.z() + layer.halfLength;
+  if (z < 0.) z = 0.;
+  int module = z / layer.moduleLength;
+  int v = (z - module * layer.moduleLength) / layer.pitchZ;
+
+  return Pack(ilayer, stave, module, u, v);
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
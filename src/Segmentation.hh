@@ -0,0 +1,74 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _Segmentation_h_
+#define _Segmentation_h_
+
+#include "G4UImessenger.hh"
+#include <vector>
+#include <map>
+
+class G4UIcommand;
+class G4Run;
+class G4Step;
+
+namespace G4me {
+
+/** analytic readout segmentation of the tracker layers in staves
+    (phi), modules (z) and pixels, computed from the hit position
+    without any additional placed volume. the packed id is
+    
+    bit 63 valid | 62-56 layer | 55-44 stave | 43-32 module | 31-16 pixel rphi | 15-0 pixel z **/
+  
+class Segmentation : public G4UImessenger
+{
+  
+public:
+
+  static Segmentation *Instance() {
+    if (!mInstance) mInstance = new Segmentation();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void BeginOfRunAction(const G4Run *aRun);
+
+  unsigned long long GetID(const G4Step *aStep) const;
+
+  static unsigned long long Pack(int layer, int stave, int module, int u, int v) {
+    return (1ULL << 63) |
+      ((unsigned long long)(layer & 0x7f) << 56) |
+      ((unsigned long long)(stave & 0xfff) << 44) |
+      ((unsigned long long)(module & 0xfff) << 32) |
+      ((unsigned long long)(u & 0xffff) << 16) |
+      (unsigned long long)(v & 0xffff);
+  };
+  
+private:
+
+  Segmentation() = default;
+
+  static Segmentation *mInstance;
+
+  struct Layer_t {
+    bool segmented = false;
+    int staves;
+    double dphi;        // stave width in phi
+    double radius;
+    double halfLength;
+    double moduleLength;
+    double pitchRPhi;
+    double pitchZ;
+  };
+
+  G4UIcommand *mSegmentationCmd;
+  std::map<int, std::map<std::string, double>> mSettings; // by layer, -1 for all
+  std::vector<Layer_t> mLayers;                           // by layer copy number
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _Segmentation_h_ **/
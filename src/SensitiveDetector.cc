@@ -8,6 +8,7 @@
 #include "G4ParticleDefinition.hh"
 
 #include "RootIO.hh"
+#include "Segmentation.hh"
 
 namespace G4me {
 
@@ -27,7 +28,7 @@ SensitiveDetector::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist)
   auto angle = momentumDirection.angle(position);
   if (angle > 0.92729522) return true; // asin(0.8)
   
-  RootIO::Instance()->AddHit(aStep);
+  RootIO::Instance()->AddHit(aStep, Segmentation::Instance()->GetID(aStep));
   
   return true;
 }
@@ -0,0 +1,46 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _SolenoidField_h_
+#define _SolenoidField_h_
+
+#include "G4MagneticField.hh"
+#include "G4ThreeVector.hh"
+
+namespace G4me {
+
+/** uniform solenoid field, the evaluation is a copy of the
+    field components without any position dependence **/
+  
+class SolenoidField final : public G4MagneticField
+{
+
+public:
+
+  SolenoidField(const G4ThreeVector &value = G4ThreeVector()) { SetFieldValue(value); };
+  ~SolenoidField() override = default;
+
+  void GetFieldValue(const G4double point[4], G4double *field) const override {
+    field[0] = mValue[0];
+    field[1] = mValue[1];
+    field[2] = mValue[2];
+  };
+
+  void SetFieldValue(const G4ThreeVector &value) {
+    mValue[0] = value.x();
+    mValue[1] = value.y();
+    mValue[2] = value.z();
+  };
+  G4ThreeVector GetFieldValue() const { return G4ThreeVector(mValue[0], mValue[1], mValue[2]); };
+  
+  G4Field *Clone() const override { return new SolenoidField(GetFieldValue()); };
+  
+private:
+
+  G4double mValue[3];
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _SolenoidField_h_ **/
@@ -0,0 +1,90 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "SplitMixEngine.hh"
+#include "Random.hh"
+#include <fstream>
+#include <iostream>
+
+namespace G4me {
+
+/*****************************************************************/
+
+double
+SplitMixEngine::flat()
+{
+  /** 53 bits, never 0 nor 1 **/
+  uint64_t state = mKey + mCounter++ * 0x9e3779b97f4a7c15ULL;
+  return ((Random::SplitMix64(state) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::flatArray(const int size, double *vect)
+{
+  for (int i = 0; i < size; ++i) vect[i] = flat();
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::setSeed(long seed, int)
+{
+  theSeed = seed;
+  uint64_t state = (uint64_t)seed;
+  mKey = Random::SplitMix64(state);
+  mCounter = 0;
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::setSeeds(const long *seeds, int)
+{
+  if (!seeds || !seeds[0]) return;
+  mSeeds[0] = seeds[0];
+  mSeeds[1] = seeds[1];
+  theSeeds = mSeeds;
+  uint64_t state = (uint64_t)seeds[0];
+  mKey = Random::SplitMix64(state);
+  if (seeds[1]) {
+    state ^= (uint64_t)seeds[1];
+    mKey ^= Random::SplitMix64(state);
+  }
+  theSeed = seeds[0];
+  mCounter = 0;
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::saveStatus(const char filename[]) const
+{
+  std::ofstream fout(filename);
+  fout << name() << " " << mKey << " " << mCounter << std::endl;
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::restoreStatus(const char filename[])
+{
+  std::ifstream fin(filename);
+  std::string engine;
+  fin >> engine >> mKey >> mCounter;
+  if (!fin || engine != name())
+    std::cout << " --- SplitMixEngine: cannot restore the status from " << filename << std::endl;
+}
+
+/*****************************************************************/
+
+void
+SplitMixEngine::showStatus() const
+{
+  std::cout << " --- SplitMixEngine: key " << mKey << ", counter " << mCounter << std::endl;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
@@ -3,10 +3,20 @@
 
 #include "StackingAction.hh"
 #include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4VProcess.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SystemOfUnits.hh"
 #include "RootIO.hh"
+#include "AcceptanceFilter.hh"
 
 #include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
 #include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithoutParameter.hh"
 
 namespace G4me {
 
@@ -22,7 +32,47 @@ StackingAction::StackingAction()
   mStackingTransportCmd->SetCandidates("none all primary gamma unstable");
   mStackingTransportCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 
+  mStackingRuleCmd = new G4UIcommand("/stacking/rule", this);
+  mStackingRuleCmd->SetGuidance("Add a stacking rule.");
+  mStackingRuleCmd->SetGuidance("A track is transported if it matches at least one transport rule");
+  mStackingRuleCmd->SetGuidance("and no kill rule. Tracks matching no rule are killed.");
+  mStackingRuleCmd->SetGuidance("  particle : PDG code, particle name, particle type, all, charged, neutral, stable, unstable");
+  mStackingRuleCmd->SetGuidance("  emin emax unit : kinetic energy range, negative emax for no upper limit");
+  mStackingRuleCmd->SetGuidance("  volume : logical volume where the track is created, '!' prefix to negate, any");
+  mStackingRuleCmd->SetGuidance("  origin : any, primary, secondary, decay, electromagnetic, hadronic");
+  mStackingRuleCmd->SetGuidance("  lifetime : only unstable particles with shorter lifetime [ns], negative to ignore");
+  auto parameter = new G4UIparameter("action", 's', false);
+  parameter->SetParameterCandidates("transport kill");
+  mStackingRuleCmd->SetParameter(parameter);
+  mStackingRuleCmd->SetParameter(new G4UIparameter("particle", 's', false));
+  parameter = new G4UIparameter("emin", 'd', true);
+  parameter->SetDefaultValue(0.);
+  mStackingRuleCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("emax", 'd', true);
+  parameter->SetDefaultValue(-1.);
+  mStackingRuleCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("unit", 's', true);
+  parameter->SetDefaultValue("MeV");
+  mStackingRuleCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("volume", 's', true);
+  parameter->SetDefaultValue("any");
+  mStackingRuleCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("origin", 's', true);
+  parameter->SetDefaultValue("any");
+  parameter->SetParameterCandidates("any primary secondary decay electromagnetic hadronic");
+  mStackingRuleCmd->SetParameter(parameter);
+  parameter = new G4UIparameter("lifetime", 'd', true);
+  parameter->SetDefaultValue(-1.);
+  mStackingRuleCmd->SetParameter(parameter);
+  mStackingRuleCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 
+  mStackingClearRulesCmd = new G4UIcmdWithoutParameter("/stacking/clearRules", this);
+  mStackingClearRulesCmd->SetGuidance("Remove all stacking rules");
+  mStackingClearRulesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mStackingPrintRulesCmd = new G4UIcmdWithoutParameter("/stacking/printRules", this);
+  mStackingPrintRulesCmd->SetGuidance("Print the stacking rules");
+  mStackingPrintRulesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 /*****************************************************************/
@@ -32,16 +82,215 @@ StackingAction::SetNewValue(G4UIcommand *command, G4String value)
 {
   if (command == mStackingTransportCmd) {
     if (value.compare("none") == 0) {
-      mTransportAll = false;
-      mTransportPrimary = false;
-      mTransportGamma = false;
-      mTransportUnstable = false;
+      mRules.clear();
+      mRulesChanged = true;
+    }
+    if (value.compare("all") == 0) AddRule(kTransportRule, "all");
+    if (value.compare("primary") == 0) AddRule(kTransportRule, "all", 0., -1., "any", kPrimaryOrigin);
+    if (value.compare("gamma") == 0) AddRule(kTransportRule, "gamma");
+    if (value.compare("unstable") == 0) AddRule(kTransportRule, "unstable", 0., -1., "any", kAnyOrigin, 1. * ns);
+  }
+  if (command == mStackingRuleCmd) {
+    G4String action, particle, emin, emax, unit, volume, origin;
+    double lifetime;
+    std::istringstream iss(value);
+    iss >> action >> particle >> emin >> emax >> unit >> volume >> origin >> lifetime;
+    ERuleOrigin_t eorigin = kAnyOrigin;
+    if (origin.compare("primary") == 0) eorigin = kPrimaryOrigin;
+    if (origin.compare("secondary") == 0) eorigin = kSecondaryOrigin;
+    if (origin.compare("decay") == 0) eorigin = kDecayOrigin;
+    if (origin.compare("electromagnetic") == 0) eorigin = kElectromagneticOrigin;
+    if (origin.compare("hadronic") == 0) eorigin = kHadronicOrigin;
+    AddRule(action.compare("kill") == 0 ? kKillRule : kTransportRule, particle,
+	    command->ConvertToDimensionedDouble(G4String(emin + ' ' + unit)),
+	    command->ConvertToDimensionedDouble(G4String(emax + ' ' + unit)),
+	    volume, eorigin, lifetime < 0. ? -1. : lifetime * ns);
+  }
+  if (command == mStackingClearRulesCmd) {
+    mRules.clear();
+    mRulesChanged = true;
+  }
+  if (command == mStackingPrintRulesCmd)
+    PrintRules();
+}
+
+/*****************************************************************/
+
+void
+StackingAction::AddRule(ERuleAction_t action, std::string particle,
+			double emin, double emax,
+			std::string volume, ERuleOrigin_t origin,
+			double lifetime)
+{
+  Rule_t rule;
+  rule.action = action;
+  rule.particle = particle;
+  rule.emin = emin;
+  rule.emax = emax < 0. ? DBL_MAX : emax;
+  rule.volume = volume;
+  rule.origin = origin;
+  rule.lifetime = lifetime;
+  rule.volumeVeto = false;
+  mRules.push_back(rule);
+  mRulesChanged = true;
+}
+
+/*****************************************************************/
+
+void
+StackingAction::PrintRules() const
+{
+  std::cout << " --- stacking rules: " << mRules.size() << std::endl;
+  for (const auto &rule : mRules)
+    std::cout << "     " << (rule.action == kKillRule ? "kill      " : "transport ")
+	      << rule.particle
+	      << " ekin = [" << rule.emin / MeV << ", " << (rule.emax == DBL_MAX ? -1. : rule.emax / MeV) << "] MeV"
+	      << " volume = " << rule.volume
+	      << " origin = " << rule.origin
+	      << " lifetime = " << (rule.lifetime < 0. ? -1. : rule.lifetime / ns) << " ns"
+	      << std::endl;
+}
+
+/*****************************************************************/
+
+void
+StackingAction::PrepareNewEvent()
+{
+  if (mRulesChanged) CompileRules();
+}
+
+/*****************************************************************/
+
+void
+StackingAction::CompileRules()
+{
+  /** resolve the logical volumes, several can share the same name **/
+  auto lvStore = G4LogicalVolumeStore::GetInstance();
+  for (auto &rule : mRules) {
+    rule.volumes.clear();
+    rule.volumeVeto = (rule.volume[0] == '!');
+    auto name = rule.volumeVeto ? rule.volume.substr(1) : rule.volume;
+    if (name.compare("any") == 0) continue;
+    for (auto lv : *lvStore)
+      if (lv->GetName().compare(name) == 0) rule.volumes.push_back(lv);
+    if (rule.volumes.empty())
+      std::cout << " --- stacking rule: logical volume not found: " << name << std::endl;
+  }
+
+  /** the table is indexed by particle definition and filled
+      on demand, to include also particles created on the fly **/
+  mTable.clear();
+  mTable.resize(G4ParticleTable::GetParticleTable()->entries());
+  mRulesChanged = false;
+
+  std::cout << " --- stacking rules compiled: " << mRules.size() << " rules" << std::endl;
+}
+
+/*****************************************************************/
+
+void
+StackingAction::CompileEntry(const G4ParticleDefinition *particle, Entry_t &entry) const
+{
+  entry.rules.clear();
+  for (const auto &rule : mRules)
+    if (rule.action == kKillRule && MatchParticle(rule, particle)) entry.rules.push_back(&rule);
+  auto nkill = entry.rules.size();
+  for (const auto &rule : mRules)
+    if (rule.action == kTransportRule && MatchParticle(rule, particle)) entry.rules.push_back(&rule);
+
+  /** the decision does not depend on the track if there is an
+      unconditional kill rule or if all rules are unconditional **/
+  bool unconditional = true;
+  entry.constant = false;
+  entry.transport = false;
+  for (int irule = 0; irule < entry.rules.size(); ++irule) {
+    auto rule = entry.rules[irule];
+    bool conditional = rule->emin > 0. || rule->emax < DBL_MAX || !rule->volumes.empty() || rule->volumeVeto || rule->origin != kAnyOrigin;
+    if (!conditional && irule < nkill) {
+      entry.constant = true;
+      entry.transport = false;
+      break;
     }
-    if (value.compare("all") == 0) mTransportAll = true;
-    if (value.compare("primary") == 0) mTransportPrimary = true;
-    if (value.compare("gamma") == 0) mTransportGamma = true;
-    if (value.compare("unstable") == 0) mTransportUnstable = true;
+    if (conditional) unconditional = false;
+  }
+  if (!entry.constant && unconditional) {
+    entry.constant = true;
+    entry.transport = entry.rules.size() > nkill;
   }
+  entry.compiled = true;
+}
+
+/*****************************************************************/
+
+bool
+StackingAction::MatchParticle(const Rule_t &rule, const G4ParticleDefinition *particle) const
+{
+  if (rule.lifetime >= 0. &&
+      (particle->GetPDGStable() || particle->GetPDGLifeTime() >= rule.lifetime)) return false;
+
+  const auto &name = rule.particle;
+  if (name.compare("all") == 0) return true;
+  if (name.compare("charged") == 0) return particle->GetPDGCharge() != 0.;
+  if (name.compare("neutral") == 0) return particle->GetPDGCharge() == 0.;
+  if (name.compare("stable") == 0) return particle->GetPDGStable();
+  if (name.compare("unstable") == 0) return !particle->GetPDGStable();
+  if (name.find_first_not_of("+-0123456789") == std::string::npos)
+    return particle->GetPDGEncoding() == std::stoi(name);
+  return name.compare(particle->GetParticleName()) == 0 || name.compare(particle->GetParticleType()) == 0;
+}
+
+/*****************************************************************/
+
+bool
+StackingAction::MatchTrack(const Rule_t &rule, const G4Track *aTrack) const
+{
+  auto ekin = aTrack->GetKineticEnergy();
+  if (ekin < rule.emin || ekin > rule.emax) return false;
+
+  if (rule.origin != kAnyOrigin) {
+    auto process = aTrack->GetCreatorProcess();
+    switch (rule.origin) {
+    case kPrimaryOrigin: if (aTrack->GetParentID() != 0) return false; break;
+    case kSecondaryOrigin: if (aTrack->GetParentID() == 0) return false; break;
+    case kDecayOrigin: if (!process || process->GetProcessType() != fDecay) return false; break;
+    case kElectromagneticOrigin: if (!process || process->GetProcessType() != fElectromagnetic) return false; break;
+    case kHadronicOrigin: if (!process || process->GetProcessType() != fHadronic) return false; break;
+    default: break;
+    }
+  }
+
+  if (!rule.volumes.empty() || rule.volumeVeto) {
+    auto volume = aTrack->GetVolume(); // not yet defined for primaries
+    auto lv = volume ? volume->GetLogicalVolume() : nullptr;
+    bool inside = false;
+    for (auto rlv : rule.volumes)
+      if (rlv == lv) { inside = true; break; }
+    if (inside == rule.volumeVeto) return false;
+  }
+  
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+StackingAction::DoTransport(const G4Track *aTrack)
+{
+  auto particle = aTrack->GetParticleDefinition();
+  auto id = particle->GetParticleDefinitionID();
+
+  Entry_t local;
+  Entry_t *entry = &local;
+  if (id >= 0) {
+    if (id >= mTable.size()) mTable.resize(id + 1);
+    entry = &mTable[id];
+  }
+  if (!entry->compiled) CompileEntry(particle, *entry);
+  if (entry->constant) return entry->transport;
+
+  for (auto rule : entry->rules)
+    if (MatchTrack(*rule, aTrack)) return rule->action == kTransportRule;
+  return false;
 }
 
 /*****************************************************************/
@@ -50,43 +299,24 @@ G4ClassificationOfNewTrack
 StackingAction::ClassifyNewTrack(const G4Track *aTrack)
 {
 
-  bool doTransport = false;
-
   // add track (only in pre-track phase)
   if (aTrack->GetCurrentStepNumber() == 0)
     RootIO::Instance()->AddTrack(aTrack);
 
-  // transport everything
-  if (mTransportAll) {
-    RootIO::Instance()->AddStatus(aTrack, RootIO::kTransport);
-    return fUrgent;
-  }
-    
-  // transport primaries
-  if (mTransportPrimary &&
-      aTrack->GetParentID() == 0) {
-    RootIO::Instance()->AddStatus(aTrack, RootIO::kTransport);
-    return fUrgent;
-  }
-    
-  // transport gamma
-  if (mTransportGamma &&
-      aTrack->GetDefinition()->GetPDGEncoding() == 22) {
-    RootIO::Instance()->AddStatus(aTrack, RootIO::kTransport);
-    return fUrgent;
-  }
+  // transport track
+  if (DoTransport(aTrack)) {
+
+    // reject tracks that cannot reach the tracker
+    auto acceptance = AcceptanceFilter::Instance();
+    if (acceptance->IsEnabled() && !acceptance->AcceptTrack(aTrack)) {
+      if (!acceptance->IsWaitMode()) return fKill;
+      RootIO::Instance()->AddStatus(aTrack, RootIO::kTransport);
+      return fWaiting;
+    }
     
-  // transport unstable particles (depending on lifetime)
-  if (mTransportUnstable &&
-      !aTrack->GetDefinition()->GetPDGStable() && 
-      aTrack->GetDefinition()->GetPDGLifeTime() < mTransportUnstableLifeTime) {
     RootIO::Instance()->AddStatus(aTrack, RootIO::kTransport);
     return fUrgent;
   }
-    
-  // transport track
-  if (doTransport) {
-  }
 
   // kill track
   return fKill;
@@ -6,9 +6,15 @@
 
 #include "G4UserStackingAction.hh"
 #include "G4UImessenger.hh"
+#include <vector>
+#include <string>
 
 class G4UIdirectory;
+class G4UIcommand;
 class G4UIcmdWithAString;
+class G4UIcmdWithoutParameter;
+class G4ParticleDefinition;
+class G4LogicalVolume;
 
 namespace G4me {
 
@@ -22,20 +28,66 @@ public:
   ~StackingAction() = default;
   
   G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track *aTrack) override;
+  void PrepareNewEvent() override;
   
 protected:
 
-  bool mTransportAll = false;
-  bool mTransportPrimary = false;
-  bool mTransportGamma = false;
-  bool mTransportUnstable = false;
+  enum ERuleAction_t {
+    kTransportRule,
+    kKillRule
+  };
+
+  enum ERuleOrigin_t {
+    kAnyOrigin,
+    kPrimaryOrigin,
+    kSecondaryOrigin,
+    kDecayOrigin,
+    kElectromagneticOrigin,
+    kHadronicOrigin
+  };
+  
+  struct Rule_t {
+    ERuleAction_t action;
+    std::string particle;  // pdg code, particle name, particle type or class
+    double emin;           // kinetic energy range
+    double emax;
+    std::string volume;    // origin logical volume, '!' prefix to negate
+    ERuleOrigin_t origin;
+    double lifetime;       // only unstable particles with shorter lifetime, if positive
+    std::vector<const G4LogicalVolume *> volumes; //! compiled
+    bool volumeVeto;                              //! compiled
+  };
+
+  /** compiled decision for one particle definition **/
+  struct Entry_t {
+    bool compiled = false;
+    bool constant = false;
+    bool transport = false;
+    std::vector<const Rule_t *> rules; // kill rules first
+  };
+  
+  void AddRule(ERuleAction_t action, std::string particle,
+	       double emin = 0., double emax = -1.,
+	       std::string volume = "any", ERuleOrigin_t origin = kAnyOrigin,
+	       double lifetime = -1.);
+  void CompileRules();
+  void CompileEntry(const G4ParticleDefinition *particle, Entry_t &entry) const;
+  bool MatchParticle(const Rule_t &rule, const G4ParticleDefinition *particle) const;
+  bool MatchTrack(const Rule_t &rule, const G4Track *aTrack) const;
+  bool DoTransport(const G4Track *aTrack);
+  void PrintRules() const;
   
-  double mTransportUnstableLifeTime = 1.; // ns
+  std::vector<Rule_t> mRules;
+  std::vector<Entry_t> mTable; // indexed by particle definition ID
+  bool mRulesChanged = true;
 
   void SetNewValue(G4UIcommand *command, G4String value);
   
   G4UIdirectory *mStackingDirectory;
   G4UIcmdWithAString *mStackingTransportCmd;
+  G4UIcommand *mStackingRuleCmd;
+  G4UIcmdWithoutParameter *mStackingClearRulesCmd;
+  G4UIcmdWithoutParameter *mStackingPrintRulesCmd;
 };
 
 } /** namespace G4me **/
@@ -8,32 +8,83 @@
 #include "G4ProcessType.hh"
 #include "G4EmProcessSubType.hh"
 #include "G4TrackStatus.hh"
+#include "G4ParticleTable.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
 #include "RootIO.hh"
+#include "TrackInformation.hh"
+#include "AcceptanceFilter.hh"
+#include "TrackingLimits.hh"
+#include "Profiler.hh"
 
 namespace G4me {
 
 /******************************************************************************/
 
-void
-SteppingAction::UserSteppingAction(const G4Step *aStep)
+SteppingAction::SteppingAction()
 {
+  mAcceptanceFilter = AcceptanceFilter::Instance();
+  mTrackingLimits = TrackingLimits::Instance();
+  mProfiler = Profiler::Instance();
+}
 
-  auto track = aStep->GetTrack();
-  auto process = aStep->GetPostStepPoint()->GetProcessDefinedStep();
-  auto type = process->GetProcessType();
+/******************************************************************************/
 
-  if (type == fTransportation)
-    return;
-  else if (type == fElectromagnetic) {
-    RootIO::Instance()->AddStatus(track, RootIO::kElectromagnetic);
+int
+SteppingAction::ComputeStatus(const G4VProcess *process) const
+{
+  if (!process) return 0;
+  auto type = process->GetProcessType();
+  int status = 0;
+  if (type == fElectromagnetic) {
+    status |= RootIO::kElectromagnetic;
     auto subtype = process->GetProcessSubType();
-    if (subtype == fComptonScattering) RootIO::Instance()->AddStatus(track, RootIO::kCompton);
-    if (subtype == fGammaConversion) RootIO::Instance()->AddStatus(track, RootIO::kConversion);
+    if (subtype == fComptonScattering) status |= RootIO::kCompton;
+    if (subtype == fGammaConversion) status |= RootIO::kConversion;
   } else if (type == fHadronic) {
-    RootIO::Instance()->AddStatus(track, RootIO::kHadronic);
+    status |= RootIO::kHadronic;
   } else if (type == fDecay) {
-    RootIO::Instance()->AddStatus(track, RootIO::kDecay);
+    status |= RootIO::kDecay;
   }
+  return status;
+}
+
+/******************************************************************************/
+
+void
+SteppingAction::BuildStatusTable()
+{
+  auto particleIterator = G4ParticleTable::GetParticleTable()->GetIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    auto pmanager = particleIterator->value()->GetProcessManager();
+    if (!pmanager) continue;
+    auto processVector = pmanager->GetProcessList();
+    for (int i = 0; i < processVector->length(); ++i) {
+      auto process = (*processVector)[i];
+      mStatusTable[process] = ComputeStatus(process);
+    }
+  }
+  std::cout << " --- stepping status table: " << mStatusTable.size() << " processes" << std::endl;
+}
+
+/******************************************************************************/
+
+void
+SteppingAction::UserSteppingAction(const G4Step *aStep)
+{
+
+  auto track = aStep->GetTrack();
+
+  if (mProfiler->IsEnabled()) mProfiler->Step(aStep);
+  if (mAcceptanceFilter->IsEnabled()) mAcceptanceFilter->Step(aStep);
+  if (mTrackingLimits->IsEnabled()) mTrackingLimits->Apply(aStep);
+
+  /** the table is built once, when the physics is in place **/
+  if (mStatusTable.empty()) BuildStatusTable();
+
+  auto status = GetStatus(aStep->GetPostStepPoint()->GetProcessDefinedStep());
+  if (status) static_cast<TrackInformation *>(track->GetUserInformation())->AddStatus(status);
   
 }
 
@@ -2,24 +2,50 @@
 /// @email: preghenella@bo.infn.it
 
 #ifndef _SteppingAction_h_
-#define _StepppingAction_h_
+#define _SteppingAction_h_
 
 #include "G4UserSteppingAction.hh"
+#include <unordered_map>
+
+class G4VProcess;
 
 namespace G4me {
 
+class AcceptanceFilter;
+class TrackingLimits;
+class Profiler;
+  
 class SteppingAction : public G4UserSteppingAction
 {
 
 public:
   
-  SteppingAction() = default;
+  SteppingAction();
   ~SteppingAction() = default;
   
   void UserSteppingAction(const G4Step *astep) override;
   
 protected:
 
+  /** status bits for the process that defined the step **/
+  void BuildStatusTable();
+  int ComputeStatus(const G4VProcess *process) const;
+  int GetStatus(const G4VProcess *process) {
+    if (process == mLastProcess) return mLastStatus;
+    mLastProcess = process;
+    auto it = mStatusTable.find(process);
+    if (it != mStatusTable.end()) return mLastStatus = it->second;
+    return mLastStatus = mStatusTable[process] = ComputeStatus(process);
+  };
+  
+  std::unordered_map<const G4VProcess *, int> mStatusTable;
+  const G4VProcess *mLastProcess = nullptr;
+  int mLastStatus = 0;
+
+  AcceptanceFilter *mAcceptanceFilter;
+  TrackingLimits *mTrackingLimits;
+  Profiler *mProfiler;
+  
 };
 
 } /** namespace G4me **/
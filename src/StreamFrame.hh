@@ -0,0 +1,40 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _StreamFrame_h_
+#define _StreamFrame_h_
+
+#include <cstdint>
+
+namespace G4me {
+namespace Stream {
+
+/** one frame per event, native byte order:
+
+    Header_t
+    int64 event
+    events    the columns of G4ME_EVENTS_SCHEMA, one value each
+    hits      int32 n, then the columns of G4ME_HITS_SCHEMA, n values each
+    tracks    int32 n, then the columns of G4ME_TRACKS_SCHEMA
+    particles int32 n, then the columns of G4ME_PARTICLES_SCHEMA
+
+    the columns are in the order of RootIOSchema.hh, all of them
+    are sent also when disabled with /io/branches.
+    n = 0 for particles that are not saved.
+    the version changes with the schema: 2 adds the tracks ancestor,
+    depth, hit0, nhits and the particles track columns, 3 adds the
+    events columns **/
+
+const uint32_t kMagic = 0x454d3447; // "G4ME"
+const uint32_t kVersion = 3;
+
+struct Header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;   // payload bytes after the header
+};
+
+} /** namespace Stream **/
+} /** namespace G4me **/
+
+#endif /** _StreamFrame_h_ **/
@@ -0,0 +1,133 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "StreamWriter.hh"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace G4me {
+
+/*****************************************************************/
+
+bool
+StreamWriter::Open(const std::string &path, int depth)
+{
+  /** a consumer that goes away must not kill the simulation **/
+  std::signal(SIGPIPE, SIG_IGN);
+
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    std::cout << " --- stream: " << path << " does not exist, start the consumer first" << std::endl;
+    return false;
+  }
+  if (S_ISFIFO(st.st_mode)) {
+    std::cout << " --- stream: waiting for a reader on " << path << std::endl;
+    mFd = open(path.c_str(), O_WRONLY);
+  }
+  else if (S_ISSOCK(st.st_mode)) {
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    mFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (mFd >= 0 && connect(mFd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+      close(mFd);
+      mFd = -1;
+    }
+  }
+  if (mFd < 0) {
+    std::cout << " --- stream: cannot open " << path << ": " << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  mDepth = depth > 0 ? depth : 1;
+  mDone = mError = false;
+  mBytes = mFrames = 0;
+  mThread = std::thread(&StreamWriter::Loop, this);
+  std::cout << " --- stream: connected to " << path << std::endl;
+  return true;
+}
+
+/*****************************************************************/
+
+bool
+StreamWriter::Push(std::vector<char> &&frame)
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mNotFull.wait(lock, [this] { return mQueue.size() < mDepth || mError; });
+  if (mError) return false;
+  mQueue.push_back(std::move(frame));
+  mNotEmpty.notify_one();
+  return true;
+}
+
+/*****************************************************************/
+
+void
+StreamWriter::Close()
+{
+  if (mFd < 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDone = true;
+  }
+  mNotEmpty.notify_one();
+  mThread.join();
+  close(mFd);
+  mFd = -1;
+}
+
+/*****************************************************************/
+
+void
+StreamWriter::Loop()
+{
+  while (true) {
+    std::vector<char> frame;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mNotEmpty.wait(lock, [this] { return !mQueue.empty() || mDone; });
+      if (mQueue.empty()) return;
+      frame = std::move(mQueue.front());
+      mQueue.pop_front();
+    }
+    mNotFull.notify_one();
+    if (WriteAll(frame.data(), frame.size())) {
+      mBytes += frame.size();
+      mFrames++;
+      continue;
+    }
+    std::cout << " --- stream: write failed, the consumer is gone: " << std::strerror(errno) << std::endl;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mError = true;
+    mQueue.clear();
+    mNotFull.notify_all();
+    return;
+  }
+}
+
+/*****************************************************************/
+
+bool
+StreamWriter::WriteAll(const char *data, size_t size)
+{
+  while (size > 0) {
+    auto n = write(mFd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
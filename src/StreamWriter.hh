@@ -0,0 +1,57 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _StreamWriter_h_
+#define _StreamWriter_h_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace G4me {
+
+/** writes frames to a named pipe or to a Unix-domain socket
+    from a separate thread. the queue holds at most depth frames,
+    Push blocks when it is full so that a slow consumer slows
+    down the simulation instead of filling the memory **/
+
+class StreamWriter
+{
+
+public:
+
+  StreamWriter() = default;
+  ~StreamWriter() { Close(); };
+
+  bool Open(const std::string &path, int depth);
+  bool Push(std::vector<char> &&frame);
+  void Close();
+
+  long long GetBytes() const { return mBytes; };
+  long long GetFrames() const { return mFrames; };
+
+private:
+
+  void Loop();
+  bool WriteAll(const char *data, size_t size);
+
+  int mFd = -1;
+  size_t mDepth = 16;
+  std::deque<std::vector<char>> mQueue;
+  std::mutex mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+  std::thread mThread;
+  bool mDone = false;
+  bool mError = false;
+  long long mBytes = 0;
+  long long mFrames = 0;
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _StreamWriter_h_ **/
@@ -0,0 +1,10 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "TrackInformation.hh"
+
+namespace G4me {
+
+G4ThreadLocal G4Allocator<TrackInformation> *TrackInformationAllocator = nullptr;
+
+} /** namespace G4me **/
@@ -0,0 +1,51 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _TrackInformation_h_
+#define _TrackInformation_h_
+
+#include "G4VUserTrackInformation.hh"
+#include "G4Allocator.hh"
+
+namespace G4me {
+
+class TrackInformation : public G4VUserTrackInformation
+{
+  
+public:
+  
+  TrackInformation() = default;
+  ~TrackInformation() override = default;
+
+  inline void *operator new(size_t);
+  inline void operator delete(void *info);
+  
+  void Print() const override {};
+
+  int GetStatus() const { return mStatus; };
+  void AddStatus(int val) { mStatus |= val; };
+  
+protected:
+
+  int mStatus = 0;
+  
+};
+
+extern G4ThreadLocal G4Allocator<TrackInformation> *TrackInformationAllocator;
+
+inline void *
+TrackInformation::operator new(size_t)
+{
+  if (!TrackInformationAllocator) TrackInformationAllocator = new G4Allocator<TrackInformation>;
+  return (void *)TrackInformationAllocator->MallocSingle();
+}
+
+inline void
+TrackInformation::operator delete(void *info)
+{
+  TrackInformationAllocator->FreeSingle((TrackInformation *)info);
+}
+
+} /** namespace G4me **/
+  
+#endif /** _TrackInformation_h_ **/
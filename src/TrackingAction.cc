@@ -0,0 +1,45 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "TrackingAction.hh"
+#include "G4Track.hh"
+#include "G4TrackingManager.hh"
+#include "ExternalDecayer.hh"
+#include "TrackInformation.hh"
+#include "RootIO.hh"
+#include "Profiler.hh"
+
+namespace G4me {
+
+/******************************************************************************/
+
+void
+TrackingAction::PreUserTrackingAction(const G4Track *aTrack)
+{
+#ifdef G4ME_STEPPING_ACTION
+  /** status bits are accumulated along the track **/
+  if (!aTrack->GetUserInformation())
+    fpTrackingManager->SetUserTrackInformation(new TrackInformation);
+#endif
+
+  auto profiler = Profiler::Instance();
+  if (profiler->IsEnabled()) profiler->PreTrack(aTrack);
+}
+
+/******************************************************************************/
+
+void
+TrackingAction::PostUserTrackingAction(const G4Track *aTrack)
+{
+#ifdef G4ME_STEPPING_ACTION
+  auto info = static_cast<TrackInformation *>(aTrack->GetUserInformation());
+  if (info->GetStatus()) RootIO::Instance()->AddStatus(aTrack, info->GetStatus());
+#endif
+  
+  /** secondaries are not stacked yet, fix the vertices of decay products **/
+  ExternalDecayer::Instance()->ApplyDisplacements(fpTrackingManager->GimmeSecondaries());
+}
+
+/******************************************************************************/
+
+} /** namespace G4me **/
@@ -0,0 +1,28 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _TrackingAction_h_
+#define _TrackingAction_h_
+
+#include "G4UserTrackingAction.hh"
+
+namespace G4me {
+
+class TrackingAction : public G4UserTrackingAction
+{
+
+public:
+  
+  TrackingAction() = default;
+  ~TrackingAction() = default;
+  
+  void PreUserTrackingAction(const G4Track *aTrack) override;
+  void PostUserTrackingAction(const G4Track *aTrack) override;
+  
+protected:
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _TrackingAction_h_ **/
@@ -0,0 +1,180 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#include "TrackingLimits.hh"
+#include "RootIO.hh"
+#include "FieldSetup.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "G4RegionStore.hh"
+#include "G4Region.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Run.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+
+namespace G4me {
+
+TrackingLimits *TrackingLimits::mInstance = nullptr;
+
+/*****************************************************************/
+
+void
+TrackingLimits::InitMessenger()
+{
+  mDirectory = new G4UIdirectory("/tracking/limits/");
+
+  mMaxTimeCmd = new G4UIcmdWithADoubleAndUnit("/tracking/limits/maxTime", this);
+  mMaxTimeCmd->SetGuidance("Kill tracks beyond this global time, negative to disable.");
+  mMaxTimeCmd->SetParameterName("time", false);
+  mMaxTimeCmd->SetUnitCategory("Time");
+  mMaxTimeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMaxTurnsCmd = new G4UIcmdWithADouble("/tracking/limits/maxTurns", this);
+  mMaxTurnsCmd->SetGuidance("Kill charged tracks after this number of turns in the solenoid field, negative to disable.");
+  mMaxTurnsCmd->SetGuidance("The field is assumed uniform, the limit is disabled with a field map.");
+  mMaxTurnsCmd->SetParameterName("turns", false);
+  mMaxTurnsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMaxLengthCmd = new G4UIcmdWithADoubleAndUnit("/tracking/limits/maxLengthPerGeV", this);
+  mMaxLengthCmd->SetGuidance("Kill tracks longer than this length per GeV/c of momentum, negative to disable.");
+  mMaxLengthCmd->SetParameterName("length", false);
+  mMaxLengthCmd->SetUnitCategory("Length");
+  mMaxLengthCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  mMinEkinCmd = new G4UIcommand("/tracking/limits/minEkin", this);
+  mMinEkinCmd->SetGuidance("Kill tracks below this kinetic energy in the region, negative to disable.");
+  mMinEkinCmd->SetParameter(new G4UIparameter("region", 's', false));
+  mMinEkinCmd->SetParameter(new G4UIparameter("ekin", 'd', false));
+  mMinEkinCmd->SetParameter(new G4UIparameter("unit", 's', false));
+  mMinEkinCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+/*****************************************************************/
+
+void
+TrackingLimits::SetNewValue(G4UIcommand *command, G4String value)
+{
+  if (command == mMaxTimeCmd)
+    mMaxTime = mMaxTimeCmd->GetNewDoubleValue(value);
+  if (command == mMaxTurnsCmd)
+    mMaxTurns = mMaxTurnsCmd->GetNewDoubleValue(value);
+  if (command == mMaxLengthCmd)
+    mMaxLengthPerGeV = mMaxLengthCmd->GetNewDoubleValue(value);
+  if (command == mMinEkinCmd) {
+    G4String region, ekin_value, ekin_unit;
+    std::istringstream iss(value);
+    iss >> region >> ekin_value >> ekin_unit;
+    mMinEkin[region] = command->ConvertToDimensionedDouble(G4String(ekin_value + ' ' + ekin_unit));
+  }
+}
+
+/*****************************************************************/
+
+void
+TrackingLimits::BeginOfRunAction(const G4Run *aRun)
+{
+  mSteps = 0;
+  for (int i = 0; i < kNLimits; ++i) mKilled[i] = 0;
+  mStepsReclaimed = 0.;
+  mClock = std::clock();
+
+  /** the field is assumed uniform along z, not true with a map **/
+  mBz = FieldSetup::GetBzAtOrigin();
+  if (mMaxTurns > 0. && FieldSetup::Instance()->HasFieldMap()) {
+    std::cout << " --- tracking limits: maxTurns not valid with a field map, disabled" << std::endl;
+    mBz = 0.;
+  }
+
+  /** resolve regions **/
+  mRegionMinEkin.clear();
+  for (const auto &minEkin : mMinEkin) {
+    if (minEkin.second < 0.) continue;
+    auto region = G4RegionStore::GetInstance()->GetRegion(minEkin.first, false);
+    if (!region) {
+      std::cout << " --- tracking limits: region not found: " << minEkin.first << std::endl;
+      continue;
+    }
+    mRegionMinEkin.push_back({region, minEkin.second});
+  }
+
+  mEnabled = mMaxTime > 0. || (mMaxTurns > 0. && mBz != 0.) || mMaxLengthPerGeV > 0. || !mRegionMinEkin.empty();
+#ifndef G4ME_STEPPING_ACTION
+  if (mEnabled) std::cout << " --- tracking limits: stepping action not built, limits are ignored" << std::endl;
+  mEnabled = false;
+#endif
+}
+
+/*****************************************************************/
+
+void
+TrackingLimits::EndOfRunAction(const G4Run *aRun)
+{
+  if (!mEnabled) return;
+  auto cpu = (double)(std::clock() - mClock) / CLOCKS_PER_SEC;
+  auto cpuPerStep = mSteps > 0 ? cpu / mSteps : 0.;
+  auto nevents = aRun->GetNumberOfEvent();
+  std::cout << " --- tracking limits report " << std::endl
+	    << "     steps/event         = " << (nevents > 0 ? (double)mSteps / nevents : 0.) << std::endl
+	    << "     killed by maxTime   = " << mKilled[kMaxTime] << std::endl
+	    << "     killed by maxTurns  = " << mKilled[kMaxTurns] << std::endl
+	    << "     killed by maxLength = " << mKilled[kMaxLength] << std::endl
+	    << "     killed by minEkin   = " << mKilled[kMinEkin] << std::endl
+	    << "     steps saved (est.)  = " << (long)mStepsReclaimed << std::endl
+	    << "     CPU saved (est.)    = " << mStepsReclaimed * cpuPerStep << " s"
+	    << " (" << (cpu > 0. ? 100. * mStepsReclaimed * cpuPerStep / cpu : 0.) << "% of " << cpu << " s)" << std::endl;
+}
+
+/*****************************************************************/
+
+bool
+TrackingLimits::Apply(const G4Step *aStep)
+{
+  mSteps++;
+  
+  auto track = aStep->GetTrack();
+  auto limit = kNLimits;
+  
+  if (mMaxTime > 0. && track->GetGlobalTime() > mMaxTime)
+    limit = kMaxTime;
+  else if (mMaxLengthPerGeV > 0. &&
+	   track->GetTrackLength() > mMaxLengthPerGeV * track->GetMomentum().mag() / GeV)
+    limit = kMaxLength;
+  else if (mMaxTurns > 0. && mBz != 0.) {
+    /** the swept transverse angle is L q c B / p **/
+    auto charge = track->GetDynamicParticle()->GetCharge();
+    if (charge != 0. &&
+	track->GetTrackLength() * std::fabs(charge * c_light * mBz) > twopi * mMaxTurns * track->GetMomentum().mag())
+      limit = kMaxTurns;
+  }
+  if (limit == kNLimits && !mRegionMinEkin.empty()) {
+    auto region = aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume()->GetRegion();
+    for (const auto &minEkin : mRegionMinEkin)
+      if (minEkin.first == region && track->GetKineticEnergy() < minEkin.second) {
+	limit = kMinEkin;
+	break;
+      }
+  }
+  if (limit == kNLimits) return false;
+
+  track->SetTrackStatus(fStopAndKill);
+  RootIO::Instance()->AddStatus(track, RootIO::kUserLimit);
+  mKilled[limit]++;
+
+  /** estimate the remaining steps from the average energy loss per step,
+      tracks that do not lose energy are assumed to be half-way through **/
+  auto nsteps = track->GetCurrentStepNumber();
+  auto eloss = (track->GetVertexKineticEnergy() - track->GetKineticEnergy()) / nsteps;
+  mStepsReclaimed += eloss > 0. ? track->GetKineticEnergy() / eloss : nsteps;
+  
+  return true;
+}
+
+/*****************************************************************/
+
+} /** namespace G4me **/
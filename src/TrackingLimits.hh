@@ -0,0 +1,81 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _TrackingLimits_h_
+#define _TrackingLimits_h_
+
+#include "G4UImessenger.hh"
+#include <vector>
+#include <map>
+#include <ctime>
+
+class G4UIdirectory;
+class G4UIcommand;
+class G4UIcmdWithADouble;
+class G4UIcmdWithADoubleAndUnit;
+class G4Run;
+class G4Step;
+class G4Region;
+
+namespace G4me {
+
+/** user limits applied in the stepping action
+    to terminate loopers and out-of-time tracks **/
+  
+class TrackingLimits : public G4UImessenger
+{
+  
+public:
+
+  static TrackingLimits *Instance() {
+    if (!mInstance) mInstance = new TrackingLimits();
+    return mInstance;
+  };
+
+  void InitMessenger();
+  void SetNewValue(G4UIcommand *command, G4String value);
+
+  void BeginOfRunAction(const G4Run *aRun);
+  void EndOfRunAction(const G4Run *aRun);
+
+  bool IsEnabled() const { return mEnabled; };
+  bool Apply(const G4Step *aStep);
+  
+private:
+
+  TrackingLimits() = default;
+
+  enum ELimit_t {
+    kMaxTime,
+    kMaxTurns,
+    kMaxLength,
+    kMinEkin,
+    kNLimits
+  };
+  
+  static TrackingLimits *mInstance;
+
+  bool mEnabled = false;
+  double mMaxTime = -1.;
+  double mMaxTurns = -1.;
+  double mMaxLengthPerGeV = -1.;
+  std::map<std::string, double> mMinEkin;
+  std::vector<std::pair<const G4Region *, double>> mRegionMinEkin;
+  double mBz = 0.;
+
+  long mSteps = 0;
+  long mKilled[kNLimits];
+  double mStepsReclaimed = 0.;
+  std::clock_t mClock = 0;
+  
+  G4UIdirectory *mDirectory;
+  G4UIcmdWithADoubleAndUnit *mMaxTimeCmd;
+  G4UIcmdWithADouble *mMaxTurnsCmd;
+  G4UIcmdWithADoubleAndUnit *mMaxLengthCmd;
+  G4UIcommand *mMinEkinCmd;
+  
+};
+
+} /** namespace G4me **/
+  
+#endif /** _TrackingLimits_h_ **/
@@ -2,7 +2,13 @@
 /// @email: preghenella@bo.infn.it
 
 #include "RootIO.hh"
-#include "G4RunManager.hh"
+#include "AcceptanceFilter.hh"
+#include "TrackingLimits.hh"
+#include "Profiler.hh"
+#include "FieldSetup.hh"
+#include "Segmentation.hh"
+#include "Random.hh"
+#include "RunManager.hh"
 #include "G4UIExecutive.hh"
 #include "G4UImanager.hh"
 #include "FTFP_BERT.hh"
@@ -15,17 +21,28 @@
 #include "EventAction.hh"
 #include "StackingAction.hh"
 #include "SteppingAction.hh"
+#include "TrackingAction.hh"
 
 int
 main(int argc, char **argv)
 {
 
+  /** g4me [--jobs N] [macro] **/
+  int jobs = 1;
+  std::string fileName;
+  for (int iarg = 1; iarg < argc; ++iarg) {
+    std::string arg = argv[iarg];
+    if (arg.compare("--jobs") == 0 && iarg + 1 < argc) jobs = std::atoi(argv[++iarg]);
+    else fileName = arg;
+  }
+
   std::vector<G4String> physicsList = {
     "G4EmStandardPhysics",
     "G4DecayPhysics"
   };
   
-  auto run = new G4RunManager;
+  auto run = new G4me::RunManager;
+  run->SetJobs(jobs);
   auto physics = new FTFP_BERT;
   physics->RegisterPhysics(new G4me::ExternalDecayerPhysics());
   auto detector = new G4me::DetectorConstruction();
@@ -38,19 +55,28 @@ main(int argc, char **argv)
   auto action_run = new G4me::RunAction();
   auto action_event = new G4me::EventAction();
   auto action_stacking = new G4me::StackingAction();
-  auto action_stepping = new G4me::SteppingAction();
+  auto action_tracking = new G4me::TrackingAction();
   
   run->SetUserAction(action_generator);
   run->SetUserAction(action_run);
   run->SetUserAction(action_event);
   run->SetUserAction(action_stacking);
-  run->SetUserAction(action_stepping);
+#ifdef G4ME_STEPPING_ACTION
+  run->SetUserAction(new G4me::SteppingAction());
+#endif
+  run->SetUserAction(action_tracking);
 
-  // initialize RootIO messenger
+  // initialize messengers
   G4me::RootIO::Instance()->InitMessenger();
+  G4me::AcceptanceFilter::Instance()->InitMessenger();
+  G4me::TrackingLimits::Instance()->InitMessenger();
+  G4me::Profiler::Instance()->InitMessenger();
+  G4me::FieldSetup::Instance()->InitMessenger();
+  G4me::Segmentation::Instance()->InitMessenger();
+  G4me::Random::Instance()->InitMessenger();
 
   // start interative session
-  if (argc == 1) {
+  if (fileName.empty()) {
     auto ui = new G4UIExecutive(argc, argv, "tcsh");
     ui->SessionStart();
     delete ui;  
@@ -59,7 +85,6 @@ main(int argc, char **argv)
 
   auto uiManager = G4UImanager::GetUIpointer();
   std::string command = "/control/execute ";
-  std::string fileName = argv[1];
   uiManager->ApplyCommand(command + fileName);
   
   //  G4VisManager* visManager = new G4VisExecutive;
@@ -0,0 +1,116 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _FlatReader_h_
+#define _FlatReader_h_
+
+/** zero-copy reader of the flat columnar format (.g4f).
+    the file is mapped in memory, the columns are typed views
+    on the mapping and the collection index gives the entries
+    of each event
+
+    G4me::FlatReader reader("pythia8.000.g4f");
+    auto index = reader.Get<uint64_t>("tracks.index");
+    auto pdg = reader.Get<int>("tracks.pdg");
+    for (uint64_t ev = 0; ev < reader.GetEvents(); ++ev)
+      for (auto i = index[ev]; i < index[ev + 1]; ++i)
+        count(pdg[i]);
+**/
+
+#include "FlatFormat.hh"
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace G4me {
+
+template <typename T> struct FlatType_t;
+template <> struct FlatType_t<char> { static const uint32_t value = Flat::kChar; };
+template <> struct FlatType_t<int> { static const uint32_t value = Flat::kInt; };
+template <> struct FlatType_t<uint64_t> { static const uint32_t value = Flat::kULong64; };
+template <> struct FlatType_t<float> { static const uint32_t value = Flat::kFloat; };
+template <> struct FlatType_t<double> { static const uint32_t value = Flat::kDouble; };
+template <> struct FlatType_t<int64_t> { static const uint32_t value = Flat::kLong64; };
+
+template <typename T>
+struct FlatColumn_t {
+  const T *data = nullptr;
+  uint64_t size = 0;
+  const T &operator[](uint64_t i) const { return data[i]; };
+  const T *begin() const { return data; };
+  const T *end() const { return data + size; };
+};
+
+class FlatReader
+{
+
+public:
+
+  FlatReader(const std::string &filename) {
+    auto fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      if (fd >= 0) close(fd);
+      throw std::runtime_error("cannot open " + filename);
+    }
+    mSize = st.st_size;
+    mData = (const char *)mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mData == MAP_FAILED) throw std::runtime_error("cannot map " + filename);
+    mHeader = (const Flat::Header_t *)mData;
+    if (mSize < sizeof(Flat::Header_t) || std::memcmp(mHeader->magic, Flat::kMagic, sizeof(Flat::kMagic)) != 0 ||
+	mHeader->version != Flat::kVersion ||
+	mSize < sizeof(Flat::Header_t) + mHeader->ncolumns * sizeof(Flat::Column_t)) {
+      munmap((void *)mData, mSize);
+      throw std::runtime_error("not a g4me flat file: " + filename);
+    }
+    mDirectory = (const Flat::Column_t *)(mData + sizeof(Flat::Header_t));
+  };
+
+  ~FlatReader() { munmap((void *)mData, mSize); };
+
+  FlatReader(const FlatReader &) = delete;
+  FlatReader &operator=(const FlatReader &) = delete;
+
+  uint64_t GetEvents() const { return mHeader->nevents; };
+  uint32_t GetColumns() const { return mHeader->ncolumns; };
+  const Flat::Column_t &GetColumn(uint32_t i) const { return mDirectory[i]; };
+
+  const Flat::Column_t *Find(const std::string &name) const {
+    for (uint32_t i = 0; i < mHeader->ncolumns; ++i)
+      if (name.compare(mDirectory[i].name) == 0) return &mDirectory[i];
+    return nullptr;
+  };
+
+  template <typename T>
+  FlatColumn_t<T> Get(const std::string &name) const {
+    auto column = Find(name);
+    if (!column) throw std::runtime_error("no column " + name);
+    if (column->type != FlatType_t<T>::value) throw std::runtime_error("wrong type for column " + name);
+    if (column->offset + column->count * sizeof(T) > mSize) throw std::runtime_error("truncated column " + name);
+    return {(const T *)(mData + column->offset), column->count};
+  };
+
+  /** sequential access hint for a full scan **/
+  void WillNeed() const {
+    madvise((void *)mData, mSize, MADV_SEQUENTIAL);
+    madvise((void *)mData, mSize, MADV_WILLNEED);
+  };
+
+private:
+
+  const char *mData = nullptr;
+  size_t mSize = 0;
+  const Flat::Header_t *mHeader = nullptr;
+  const Flat::Column_t *mDirectory = nullptr;
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _FlatReader_h_ **/
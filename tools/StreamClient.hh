@@ -0,0 +1,148 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+#ifndef _StreamClient_h_
+#define _StreamClient_h_
+
+/** minimal client for the g4me event stream (/io/stream).
+    the client creates the named pipe or the Unix socket, g4me
+    connects to it at the beginning of each run and closes it at
+    the end. Next returns false at the end of a run, call Wait to
+    accept the next one
+
+    G4me::StreamClient client;
+    client.Create("/tmp/g4me.fifo");
+    while (client.Wait())
+      while (client.Next(event))
+        reconstruct(event);
+**/
+
+#include "StreamFrame.hh"
+#include "RootIOSchema.hh"
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace G4me {
+
+struct StreamEvent_t {
+  long long event;
+  struct { G4ME_EVENTS_SCHEMA(G4ME_SCHEMA_SCALAR) } events;
+#define G4ME_STREAM_COLLECTION(collection, tree, schema) struct { schema(G4ME_SCHEMA_VECTOR) } collection;
+  G4ME_COLLECTIONS(G4ME_STREAM_COLLECTION)
+#undef G4ME_STREAM_COLLECTION
+};
+
+class StreamClient
+{
+
+public:
+
+  StreamClient() = default;
+  ~StreamClient() { Destroy(); };
+
+  /** named pipe by default, Unix socket if socket is true **/
+  bool Create(const std::string &path, bool socket = false) {
+    mPath = path;
+    unlink(path.c_str());
+    if (!socket) return mkfifo(path.c_str(), 0600) == 0;
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    mListen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    return mListen >= 0 && bind(mListen, (struct sockaddr *)&address, sizeof(address)) == 0 && listen(mListen, 1) == 0;
+  };
+
+  /** blocks until g4me connects **/
+  bool Wait() {
+    Disconnect();
+    mFd = mListen >= 0 ? accept(mListen, nullptr, nullptr) : open(mPath.c_str(), O_RDONLY);
+    return mFd >= 0;
+  };
+
+  bool Next(StreamEvent_t &event) {
+    Stream::Header_t header;
+    if (!Read(&header, sizeof(header))) return false;
+    if (header.magic != Stream::kMagic || header.version != Stream::kVersion) return false;
+    mBuffer.resize(header.size);
+    if (!Read(mBuffer.data(), header.size)) return false;
+    mBytes += sizeof(header) + header.size;
+
+    mOffset = 0;
+    int64_t id;
+    Get(&id, sizeof(id));
+    event.event = id;
+#define G4ME_STREAM_SCALAR(type, name, leaf) Get(&event.events.name, sizeof(type));
+    G4ME_EVENTS_SCHEMA(G4ME_STREAM_SCALAR)
+#undef G4ME_STREAM_SCALAR
+    size_t n;
+#define G4ME_STREAM_COLUMN(type, name, leaf) column.name.resize(n); Get(column.name);
+#define G4ME_STREAM_COLLECTION(collection, tree, schema) { auto &column = event.collection; n = Size(); schema(G4ME_STREAM_COLUMN) }
+    G4ME_COLLECTIONS(G4ME_STREAM_COLLECTION)
+#undef G4ME_STREAM_COLLECTION
+#undef G4ME_STREAM_COLUMN
+    return mOffset == mBuffer.size();
+  };
+
+  long long GetBytes() const { return mBytes; };
+
+  void Disconnect() {
+    if (mFd >= 0) close(mFd);
+    mFd = -1;
+  };
+
+  void Destroy() {
+    Disconnect();
+    if (mListen >= 0) close(mListen);
+    mListen = -1;
+    if (!mPath.empty()) unlink(mPath.c_str());
+    mPath.clear();
+  };
+
+private:
+
+  bool Read(void *data, size_t size) {
+    auto p = (char *)data;
+    while (size > 0) {
+      auto n = read(mFd, p, size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p += n;
+      size -= n;
+    }
+    return true;
+  };
+
+  void Get(void *data, size_t size) {
+    if (mOffset + size > mBuffer.size()) size = mBuffer.size() - mOffset;
+    std::memcpy(data, mBuffer.data() + mOffset, size);
+    mOffset += size;
+  };
+  
+  template <typename T> void Get(std::vector<T> &column) { Get(column.data(), column.size() * sizeof(T)); };
+
+  size_t Size() {
+    int32_t n = 0;
+    Get(&n, sizeof(n));
+    return n > 0 ? n : 0;
+  };
+
+  std::string mPath;
+  int mFd = -1;
+  int mListen = -1;
+  std::vector<char> mBuffer;
+  size_t mOffset = 0;
+  long long mBytes = 0;
+
+};
+
+} /** namespace G4me **/
+
+#endif /** _StreamClient_h_ **/
@@ -0,0 +1,71 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/** g4me-consume: test consumer of the g4me event stream.
+    creates the pipe or socket, reads the events of each run
+    and prints the throughput **/
+
+#include "StreamClient.hh"
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+/*****************************************************************/
+
+void
+usage()
+{
+  std::cout << "usage: g4me-consume [options] <path>" << std::endl
+	    << "  --socket          create a Unix socket instead of a named pipe" << std::endl
+	    << "  --runs <n>        exit after n runs (default: run forever)" << std::endl
+	    << "  --verbose         print one line per event" << std::endl;
+}
+
+/*****************************************************************/
+
+int
+main(int argc, char **argv)
+{
+  std::string path;
+  bool socket = false, verbose = false;
+  int runs = -1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--socket") socket = true;
+    else if (arg == "--verbose") verbose = true;
+    else if (arg == "--runs" && i + 1 < argc) runs = std::atoi(argv[++i]);
+    else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+    else path = arg;
+  }
+  if (path.empty()) {
+    usage();
+    return 1;
+  }
+
+  G4me::StreamClient client;
+  if (!client.Create(path, socket)) {
+    std::cout << " --- g4me-consume: cannot create " << path << std::endl;
+    return 1;
+  }
+  std::cout << " --- g4me-consume: listening on " << path << std::endl;
+
+  G4me::StreamEvent_t event;
+  for (int run = 0; run != runs && client.Wait(); ++run) {
+    long long events = 0, tracks = 0, hits = 0, bytes = client.GetBytes();
+    auto start = std::chrono::steady_clock::now();
+    while (client.Next(event)) {
+      events++;
+      tracks += event.tracks.pdg.size();
+      hits += event.hits.trkid.size();
+      if (verbose)
+	std::cout << " --- event " << event.event << ": " << event.tracks.pdg.size() << " tracks, "
+		  << event.hits.trkid.size() << " hits, " << event.particles.pdg.size() << " particles" << std::endl;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bytes = client.GetBytes() - bytes;
+    std::cout << " --- g4me-consume: run " << run << ": " << events << " events, " << tracks << " tracks, " << hits << " hits, "
+	      << bytes / 1048576. << " MB in " << elapsed << " s (" << bytes / 1048576. / elapsed << " MB/s)" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,214 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/** g4me-flat: converts g4me ROOT outputs to the flat columnar
+    format, prints the content of flat files and times a scan
+    of one column with the zero-copy reader **/
+
+#include "FlatWriter.hh"
+#include "FlatReader.hh"
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cctype>
+
+/** the trees with per-event collections, counted by their "n" branch **/
+const std::vector<std::string> gCollections = {"Hits", "Tracks", "Particles"};
+
+/*****************************************************************/
+
+void
+usage()
+{
+  std::cout << "usage: g4me-flat <input.root> <output.g4f>     convert" << std::endl
+	    << "       g4me-flat --info <file.g4f>               list the columns" << std::endl
+	    << "       g4me-flat --scan <file.g4f> <column>      time a full scan of a column" << std::endl;
+}
+
+/*****************************************************************/
+
+bool
+flatType(const std::string &type, G4me::Flat::EType_t &flat)
+{
+  if (type == "Char_t") flat = G4me::Flat::kChar;
+  else if (type == "Int_t") flat = G4me::Flat::kInt;
+  else if (type == "ULong64_t") flat = G4me::Flat::kULong64;
+  else if (type == "Float_t") flat = G4me::Flat::kFloat;
+  else if (type == "Double_t") flat = G4me::Flat::kDouble;
+  else if (type == "Long64_t") flat = G4me::Flat::kLong64;
+  else return false;
+  return true;
+}
+
+/*****************************************************************/
+
+int
+convert(const std::string &input, const std::string &output)
+{
+  auto fin = TFile::Open(input.c_str());
+  if (!fin || fin->IsZombie()) {
+    std::cout << " --- g4me-flat: cannot open " << input << std::endl;
+    return 1;
+  }
+
+  struct Column_t {
+    int id;
+    std::vector<char> buffer;
+  };
+  struct Collection_t {
+    TTree *tree;
+    int id;
+    int n;
+    std::vector<Column_t> columns;
+  };
+  std::vector<Collection_t> collections;
+  G4me::FlatWriter writer;
+  if (!writer.Open(output)) return 1;
+
+  long long nevents = -1;
+  for (const auto &name : gCollections) {
+    auto tree = (TTree *)fin->Get(name.c_str());
+    if (!tree) continue;
+    if (nevents >= 0 && tree->GetEntries() != nevents) {
+      std::cout << " --- g4me-flat: entries mismatch in tree " << name << std::endl;
+      return 1;
+    }
+    nevents = tree->GetEntries();
+    auto lower = name;
+    for (auto &c : lower) c = std::tolower(c);
+    collections.push_back({tree, writer.Collection(lower), 0, {}});
+    auto &collection = collections.back();
+    auto nmax = (size_t)tree->GetMaximum("n");
+    tree->SetBranchStatus("*", true);
+    tree->SetBranchAddress("n", &collection.n);
+    collection.columns.reserve(tree->GetListOfLeaves()->GetEntries());
+    for (auto object : *tree->GetListOfLeaves()) {
+      auto leaf = (TLeaf *)object;
+      if (std::string(leaf->GetName()) == "n") continue;
+      G4me::Flat::EType_t type;
+      if (!flatType(leaf->GetTypeName(), type)) {
+	std::cout << " --- g4me-flat: skipping " << name << "." << leaf->GetName() << " of type " << leaf->GetTypeName() << std::endl;
+	continue;
+      }
+      collection.columns.push_back({writer.Column(collection.id, leaf->GetName(), type),
+	    std::vector<char>((nmax + 1) * G4me::Flat::Size(type))});
+      tree->SetBranchAddress(leaf->GetName(), collection.columns.back().buffer.data());
+    }
+  }
+
+  /** the event header, one value per event. the event number goes to
+      the "event" column, the entry number if there is no header **/
+  std::vector<Column_t> header;
+  int event = -1;
+  auto events = (TTree *)fin->Get("Events");
+  if (events && events->GetEntries() == nevents && events->GetBranch("event")) {
+    events->SetBranchAddress("event", &event);
+    header.reserve(events->GetListOfLeaves()->GetEntries());
+    for (auto object : *events->GetListOfLeaves()) {
+      auto leaf = (TLeaf *)object;
+      G4me::Flat::EType_t type;
+      if (std::string(leaf->GetName()) == "event" || !flatType(leaf->GetTypeName(), type)) continue;
+      header.push_back({writer.Column(std::string("events.") + leaf->GetName(), type),
+	    std::vector<char>(G4me::Flat::Size(type))});
+      events->SetBranchAddress(leaf->GetName(), header.back().buffer.data());
+    }
+  }
+  else events = nullptr;
+
+  for (long long ev = 0; ev < nevents; ++ev) {
+    if (events) {
+      events->GetEntry(ev);
+      for (auto &column : header)
+	writer.Fill(column.id, column.buffer.data(), 1);
+    }
+    for (auto &collection : collections) {
+      collection.tree->GetEntry(ev);
+      for (auto &column : collection.columns)
+	writer.Fill(column.id, column.buffer.data(), collection.n);
+      writer.Next(collection.id, collection.n);
+    }
+    writer.EndOfEvent(events ? event : ev);
+  }
+  auto ok = writer.Close();
+  std::cout << " --- g4me-flat: " << nevents << " events written to " << output << (ok ? "" : " FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
+
+/*****************************************************************/
+
+int
+info(const std::string &filename)
+{
+  const char *types[] = {"char", "int", "ulong64", "float", "double", "long64"};
+  G4me::FlatReader reader(filename);
+  std::cout << " --- " << filename << ": " << reader.GetEvents() << " events, " << reader.GetColumns() << " columns" << std::endl;
+  for (uint32_t i = 0; i < reader.GetColumns(); ++i) {
+    auto &column = reader.GetColumn(i);
+    std::cout << "     " << column.name << " (" << (column.type < 6 ? types[column.type] : "?") << ") "
+	      << column.count << " values" << std::endl;
+  }
+  return 0;
+}
+
+/*****************************************************************/
+
+template <typename T>
+double
+sum(const G4me::FlatReader &reader, const std::string &name, uint64_t &count)
+{
+  auto column = reader.Get<T>(name);
+  double result = 0.;
+  for (auto value : column) result += value;
+  count = column.size;
+  return result;
+}
+
+int
+scan(const std::string &filename, const std::string &name)
+{
+  G4me::FlatReader reader(filename);
+  auto column = reader.Find(name);
+  if (!column) {
+    std::cout << " --- g4me-flat: no column " << name << std::endl;
+    return 1;
+  }
+  reader.WillNeed();
+  auto start = std::chrono::steady_clock::now();
+  uint64_t count = 0;
+  double result = 0.;
+  switch (column->type) {
+  case G4me::Flat::kChar: result = sum<char>(reader, name, count); break;
+  case G4me::Flat::kInt: result = sum<int>(reader, name, count); break;
+  case G4me::Flat::kULong64: result = sum<uint64_t>(reader, name, count); break;
+  case G4me::Flat::kFloat: result = sum<float>(reader, name, count); break;
+  case G4me::Flat::kDouble: result = sum<double>(reader, name, count); break;
+  case G4me::Flat::kLong64: result = sum<int64_t>(reader, name, count); break;
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << " --- " << name << ": " << count << " values, sum = " << result << ", "
+	    << count * G4me::Flat::Size(column->type) / 1048576. / elapsed << " MB/s" << std::endl;
+  return 0;
+}
+
+/*****************************************************************/
+
+int
+main(int argc, char **argv)
+{
+  std::vector<std::string> args(argv + 1, argv + argc);
+  try {
+    if (args.size() == 2 && args[0] == "--info") return info(args[1]);
+    if (args.size() == 3 && args[0] == "--scan") return scan(args[1], args[2]);
+    if (args.size() == 2 && args[0][0] != '-') return convert(args[0], args[1]);
+  }
+  catch (const std::exception &e) {
+    std::cout << " --- g4me-flat: " << e.what() << std::endl;
+    return 1;
+  }
+  usage();
+  return 1;
+}
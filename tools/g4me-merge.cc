@@ -0,0 +1,224 @@
+/// @author: Roberto Preghenella
+/// @email: preghenella@bo.infn.it
+
+/** g4me-merge: merges g4me output files. the trees are merged in
+    parallel, each into a temporary file, with fast cloning of the
+    compressed baskets when the compression settings of all inputs
+    match and no re-clustering is requested. the temporary files
+    are then concatenated into the output, again without
+    decompression **/
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TTreeIndex.h"
+#include "TKey.h"
+#include "TFileMerger.h"
+#include "TROOT.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+/** the trees written by RootIO, one entry per event **/
+const std::vector<std::string> gEventTrees = {"Hits", "Tracks", "Particles", "Events", "EventStats"};
+
+struct Options_t {
+  std::string output;
+  std::vector<std::string> inputs;
+  int jobs = 4;
+  bool sort = false;
+  long cluster = 0;
+  int compress = -1;
+};
+
+/*****************************************************************/
+
+void
+usage()
+{
+  std::cout << "usage: g4me-merge [options] <output> <input> [input ...]" << std::endl
+	    << "  --jobs <n>        trees merged in parallel (default: 4)" << std::endl
+	    << "  --sort            order the inputs by their numbers (run, job), not as given" << std::endl
+	    << "  --cluster <n>     re-cluster the trees with <n> events per cluster (decompresses)" << std::endl
+	    << "  --compress <c>    output compression settings, e.g. 505 (decompresses if different)" << std::endl;
+}
+
+/*****************************************************************/
+
+/** natural order, numbers compared by value **/
+
+bool
+naturalLess(const std::string &a, const std::string &b)
+{
+  size_t i = 0, j = 0;
+  while (i < a.size() && j < b.size()) {
+    if (isdigit(a[i]) && isdigit(b[j])) {
+      size_t ni = i, nj = j;
+      while (ni < a.size() && isdigit(a[ni])) ni++;
+      while (nj < b.size() && isdigit(b[nj])) nj++;
+      auto va = std::stoull(a.substr(i, ni - i)), vb = std::stoull(b.substr(j, nj - j));
+      if (va != vb) return va < vb;
+      i = ni;
+      j = nj;
+      continue;
+    }
+    if (a[i] != b[j]) return a[i] < b[j];
+    i++;
+    j++;
+  }
+  return a.size() - i < b.size() - j;
+}
+
+/*****************************************************************/
+
+bool
+mergeTree(const std::string &name, const std::vector<std::string> &inputs, const std::string &output,
+	  bool fast, const Options_t &options)
+{
+  TChain chain(name.c_str());
+  for (const auto &input : inputs) chain.Add(input.c_str());
+
+  auto compress = options.compress >= 0 ? options.compress : 101;
+  if (options.compress < 0) {
+    auto fin = TFile::Open(inputs.front().c_str());
+    if (fin) compress = fin->GetCompressionSettings();
+    delete fin;
+  }
+  TFile fout(output.c_str(), "RECREATE", "", compress);
+  if (fout.IsZombie()) return false;
+
+  TTree *tree = nullptr;
+  if (fast)
+    tree = chain.CloneTree(-1, "fast");
+  else {
+    tree = chain.CloneTree(0);
+    if (tree) {
+      if (options.cluster > 0) tree->SetAutoFlush(options.cluster);
+      tree->CopyEntries(&chain, -1, "");
+    }
+  }
+  if (!tree) return false;
+  /** the index of the inputs is not carried over. the keys must be
+      unique, which is not the case when the same run is merged twice **/
+  if (name == "Events" && tree->GetBranch("run") && tree->GetBranch("event")) {
+    tree->BuildIndex("run", "event");
+    auto index = dynamic_cast<TTreeIndex *>(tree->GetTreeIndex());
+    bool unique = index != nullptr;
+    for (Long64_t i = 1; unique && i < index->GetN(); ++i)
+      unique = index->GetIndexValues()[i] != index->GetIndexValues()[i - 1];
+    if (!unique) {
+      std::cout << " --- g4me-merge: duplicate (run, event) in the Events tree, the index is not written" << std::endl;
+      tree->SetTreeIndex(nullptr);
+      delete index;
+    }
+  }
+  fout.cd();
+  tree->Write("", TObject::kOverwrite);
+  fout.Close();
+  return true;
+}
+
+/*****************************************************************/
+
+int
+main(int argc, char **argv)
+{
+  Options_t options;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--jobs" && i + 1 < argc) options.jobs = std::atoi(argv[++i]);
+    else if (arg == "--sort") options.sort = true;
+    else if (arg == "--cluster" && i + 1 < argc) options.cluster = std::atol(argv[++i]);
+    else if (arg == "--compress" && i + 1 < argc) options.compress = std::atoi(argv[++i]);
+    else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+    else files.push_back(arg);
+  }
+  if (files.size() < 2) {
+    usage();
+    return 1;
+  }
+  options.output = files.front();
+  options.inputs.assign(files.begin() + 1, files.end());
+  if (options.sort) std::sort(options.inputs.begin(), options.inputs.end(), naturalLess);
+  auto start = std::chrono::steady_clock::now();
+
+  /** check the inputs: same trees, same number of events in each,
+      fast cloning only if the compression is the same everywhere **/
+  std::vector<std::string> trees;
+  long long bytes = 0, events = 0;
+  int compress = -1;
+  bool fast = options.cluster <= 0;
+  for (const auto &input : options.inputs) {
+    auto fin = TFile::Open(input.c_str());
+    if (!fin || fin->IsZombie()) {
+      std::cout << " --- g4me-merge: cannot open " << input << std::endl;
+      return 1;
+    }
+    bytes += fin->GetSize();
+    if (compress < 0) compress = fin->GetCompressionSettings();
+    if (fin->GetCompressionSettings() != compress) fast = false;
+    if (trees.empty())
+      for (auto key : *fin->GetListOfKeys())
+	if (std::string(((TKey *)key)->GetClassName()) == "TTree") trees.push_back(key->GetName());
+    long long nevents = -1;
+    for (const auto &name : gEventTrees) {
+      auto tree = (TTree *)fin->Get(name.c_str());
+      if (!tree) continue;
+      if (nevents < 0) nevents = tree->GetEntries();
+      if (tree->GetEntries() != nevents) {
+	std::cout << " --- g4me-merge: entries mismatch in " << input << ", tree " << name << std::endl;
+	return 1;
+      }
+    }
+    events += nevents > 0 ? nevents : 0;
+    delete fin;
+  }
+  if (options.compress >= 0 && options.compress != compress) fast = false;
+  std::cout << " --- g4me-merge: " << options.inputs.size() << " files, " << events << " events, "
+	    << trees.size() << " trees, " << (fast ? "fast" : "slow") << " cloning" << std::endl;
+
+  /** merge the trees in parallel **/
+  ROOT::EnableThreadSafety();
+  std::vector<std::string> temporary;
+  for (const auto &name : trees) temporary.push_back(options.output + ".tmp." + name + ".root");
+  std::atomic<int> next(0);
+  std::atomic<bool> ok(true);
+  std::vector<std::thread> workers;
+  for (int job = 0; job < std::min<int>(options.jobs, trees.size()); ++job)
+    workers.emplace_back([&]() {
+	for (int itree = next++; itree < trees.size(); itree = next++)
+	  if (!mergeTree(trees[itree], options.inputs, temporary[itree], fast, options)) {
+	    std::cout << " --- g4me-merge: failed to merge tree " << trees[itree] << std::endl;
+	    ok = false;
+	  }
+      });
+  for (auto &worker : workers) worker.join();
+
+  /** concatenate the trees into the output **/
+  if (ok) {
+    TFileMerger merger(false, false);
+    merger.SetPrintLevel(0);
+    merger.SetFastMethod(true);
+    ok = merger.OutputFile(options.output.c_str(), "RECREATE", options.compress >= 0 ? options.compress : compress);
+    for (const auto &file : temporary) ok = ok && merger.AddFile(file.c_str(), false);
+    ok = ok && merger.Merge();
+  }
+  for (const auto &file : temporary) std::remove(file.c_str());
+  if (!ok) {
+    std::cout << " --- g4me-merge: merge failed" << std::endl;
+    return 1;
+  }
+
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << " --- g4me-merge: " << options.output << " written in " << elapsed << " s, "
+	    << bytes / 1048576. / elapsed << " MB/s, " << events / elapsed << " events/s" << std::endl;
+  return 0;
+}